@@ -0,0 +1,104 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <functional>
+#include "protocol_lite.h"
+
+// Byte-at-a-time reference, equivalent to the original single-table implementation.
+static uint16_t reference_crc16_tab[256];
+static uint32_t reference_crc32_tab[256];
+
+static void build_reference_tables() {
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc16 = i;
+        uint32_t crc32 = i;
+        for (int k = 0; k < 8; ++k) {
+            crc16 = (crc16 & 1) ? (crc16 >> 1) ^ 0xa001 : crc16 >> 1;
+            crc32 = (crc32 & 1) ? (crc32 >> 1) ^ 0xedb88320 : crc32 >> 1;
+        }
+        reference_crc16_tab[i] = (uint16_t)crc16;
+        reference_crc32_tab[i] = crc32;
+    }
+}
+
+static uint32_t reference_crc16(const uint8_t *p, uint32_t len) {
+    uint16_t crc = 0xffff;
+    while (len--) {
+        crc = (crc >> 8) ^ reference_crc16_tab[(crc ^ *p++) & 0xff];
+    }
+    return crc;
+}
+
+static uint32_t reference_crc32(const uint8_t *p, uint32_t len) {
+    uint32_t crc = 0xffffffff;
+    while (len--) {
+        crc = (crc >> 8) ^ reference_crc32_tab[(crc ^ *p++) & 0xff];
+    }
+    return crc;
+}
+
+static uint32_t sdk_crc16(const uint8_t *p, uint32_t len) {
+    return get_crc16(p, len);
+}
+
+static uint32_t sdk_crc32(const uint8_t *p, uint32_t len) {
+    return get_crc32(p, len);
+}
+
+using CrcFunction = std::function<uint32_t(const uint8_t *, uint32_t)>;
+
+static double measure_mbps(const CrcFunction &crc, const std::vector<uint8_t> &data, size_t block_size) {
+    using clock = std::chrono::steady_clock;
+    volatile uint32_t sink = 0;
+    size_t processed = 0;
+    auto start = clock::now();
+    auto elapsed = clock::duration::zero();
+    while (elapsed < std::chrono::milliseconds(200)) {
+        for (size_t offset = 0; offset + block_size <= data.size(); offset += block_size) {
+            sink = sink + crc(data.data() + offset, (uint32_t)block_size);
+            processed += block_size;
+        }
+        elapsed = clock::now() - start;
+    }
+    return (double)processed / std::chrono::duration<double>(elapsed).count() / 1e6;
+}
+
+int main(int argc, char *argv[]) {
+    build_reference_tables();
+
+    std::mt19937 rng(42);
+    std::vector<uint8_t> data(1 << 20);
+    for (auto &b : data) {
+        b = (uint8_t)rng();
+    }
+
+    for (uint32_t len = 0; len < 2048; ++len) {
+        size_t offset = rng() % 64;
+        if (reference_crc16(data.data() + offset, len) != get_crc16(data.data() + offset, len) ||
+            reference_crc32(data.data() + offset, len) != get_crc32(data.data() + offset, len)) {
+            std::cerr << "CRC mismatch at length " << len << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "CRC32 implementation: " << get_crc32_implementation() << std::endl;
+    std::cout << std::left << std::setw(8) << "crc" << std::setw(8) << "block"
+              << std::setw(16) << "reference MB/s" << std::setw(12) << "sdk MB/s" << "speedup" << std::endl;
+
+    const size_t block_sizes[] = {16, 128, 1024, 65536};
+    for (size_t block_size : block_sizes) {
+        double ref16 = measure_mbps(reference_crc16, data, block_size);
+        double sdk16 = measure_mbps(sdk_crc16, data, block_size);
+        double ref32 = measure_mbps(reference_crc32, data, block_size);
+        double sdk32 = measure_mbps(sdk_crc32, data, block_size);
+        std::cout << std::fixed << std::setprecision(1)
+                  << std::setw(8) << "crc16" << std::setw(8) << block_size
+                  << std::setw(16) << ref16 << std::setw(12) << sdk16 << sdk16 / ref16 << "x" << std::endl
+                  << std::setw(8) << "crc32" << std::setw(8) << block_size
+                  << std::setw(16) << ref32 << std::setw(12) << sdk32 << sdk32 / ref32 << "x" << std::endl;
+    }
+
+    return 0;
+}
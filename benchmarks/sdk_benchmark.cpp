@@ -0,0 +1,317 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+#include "humanoid_sdk.h"
+#include "simulated_device.h"
+
+// End-to-end benchmarks of the SDK, results are printed as one JSON object.
+//
+// Usage: sdk_benchmark [--port PATH] [--latency-us N] [--stream FILE] [--output FILE]
+//   --port       run the SDK cases over this serial port or pty instead of a simulated device
+//   --latency-us response latency of the simulated device
+//   --stream     capture file or raw byte stream used by the unpacker case instead of a generated one
+//   --output     write the JSON to a file instead of stdout
+
+using namespace humanoid_sdk;
+using Clock = std::chrono::steady_clock;
+
+static double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static double percentile(std::vector<double> &samples, double p) {
+    if (samples.empty()) {
+        return 0.0;
+    }
+    size_t index = std::min(samples.size() - 1, (size_t) (p / 100.0 * (double) samples.size()));
+    std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+    return samples[index];
+}
+
+static std::string rpc_round_trip(HumanoidSDK &sdk) {
+    std::vector<double> latencies;
+    size_t timeouts = 0;
+    LinearActuatorFeedback feedback;
+    for (int i = 0; i < 2000; ++i) {
+        auto start = Clock::now();
+        if (sdk.linear_actuator_query_state(1, feedback)) {
+            latencies.push_back(seconds_since(start) * 1e6);
+        } else {
+            timeouts++;
+        }
+    }
+    return fmt::format(R"({{"samples": {}, "timeouts": {}, "p50_us": {:.1f}, "p90_us": {:.1f}, "p99_us": {:.1f}, "max_us": {:.1f}}})",
+                       latencies.size(), timeouts, percentile(latencies, 50), percentile(latencies, 90),
+                       percentile(latencies, 99), percentile(latencies, 100));
+}
+
+// RPCs to an actuator that is polled as well, over a simulated link losing frames. Every lost request or poll costs
+// at most its own RPC: timeouts should stay near the loss rate, and no RPC may complete with the response of a poll
+// sent before it (stale).
+static std::string rpc_under_polling(SimulatedDeviceOptions device_options) {
+    device_options.loss_rate = 0.05;
+    SimulatedDevice device(device_options);
+    HumanoidSDK sdk(device.host_transport());
+    while (!sdk.is_connected()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    const int calls = 500;
+    size_t stale = 0;
+    size_t timeouts = 0;
+    LinearActuatorFeedback feedback;
+    sdk.linear_actuator_start_polling({1}, 1000);
+    for (int i = 0; i < calls; ++i) {
+        // The first half interleaves calls with the polls, the second half calls right after polling stopped.
+        bool restart = i >= calls / 2;
+        if (restart) {
+            sdk.linear_actuator_start_polling({1}, 1000);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        if (restart) {
+            sdk.linear_actuator_stop_polling();
+        }
+
+        uint16_t target = (uint16_t) (1000 + i);
+        if (!sdk.linear_actuator_set_target(1, target, feedback)) {
+            timeouts++;
+        } else if (feedback.target_position != target) {
+            stale++;
+        }
+    }
+    return fmt::format(R"({{"calls": {}, "loss_rate": {:.2f}, "timeouts": {}, "stale": {}}})",
+                       calls, device_options.loss_rate, timeouts, stale);
+}
+
+static std::string broadcast_throughput(HumanoidSDK &sdk) {
+    std::vector<uint8_t> ids;
+    std::vector<uint16_t> targets;
+    for (uint8_t id = 1; id <= 16; ++id) {
+        ids.push_back(id);
+        targets.push_back(1000);
+    }
+
+    CommunicationStatistics before = sdk.get_communication_statistics();
+    uint64_t calls = 0;
+    auto start = Clock::now();
+    while (seconds_since(start) < 1.0) {
+        targets[calls % targets.size()]++;
+        if (!sdk.linear_actuator_broadcast_follows(ids, targets)) {
+            // TX queue full, let the writer catch up.
+            std::this_thread::yield();
+        }
+        calls++;
+    }
+    double elapsed = seconds_since(start);
+    CommunicationStatistics after = sdk.get_communication_statistics();
+
+    // 16 actuators take two frames per call.
+    uint64_t dropped = after.tx_dropped_frames - before.tx_dropped_frames;
+    uint64_t frames = calls * 2 - dropped;
+    return fmt::format(R"({{"calls_per_s": {:.0f}, "frames_per_s": {:.0f}, "dropped_frames": {}, "tx_mb_per_s": {:.2f}, "bytes_per_write": {:.1f}}})",
+                       calls / elapsed, frames / elapsed, dropped,
+                       (after.tx_bytes - before.tx_bytes) / elapsed / 1e6,
+                       (double) (after.tx_bytes - before.tx_bytes) /
+                       std::max<uint64_t>(1, after.tx_write_calls - before.tx_write_calls));
+}
+
+static std::vector<uint8_t> generate_stream(size_t size) {
+    std::mt19937 rng(42);
+    std::vector<uint8_t> stream;
+    uint8_t frame[PROTOCOL_FRAME_MAX_SIZE];
+    uint8_t data[PROTOCOL_DATA_MAX_SIZE];
+    while (stream.size() < size) {
+        // Mostly actuator feedback with some console output, like a real session.
+        uint16_t len = (rng() % 8 == 0) ? (uint16_t) (rng() % PROTOCOL_DATA_MAX_SIZE)
+                                        : (uint16_t) sizeof(cmd_linear_actuator_feedback_t);
+        for (uint16_t i = 0; i < len; ++i) {
+            data[i] = (uint8_t) rng();
+        }
+        uint32_t frame_size = protocol_pack_data_to_buffer(len == sizeof(cmd_linear_actuator_feedback_t)
+                                                           ? CMD_LINEAR_ACTUATOR_RESPONSE : CMD_CONSOLE_OUTPUT,
+                                                           data, len, frame);
+        stream.insert(stream.end(), frame, frame + frame_size);
+    }
+    return stream;
+}
+
+static std::string unpacker_throughput(const std::vector<uint8_t> &stream) {
+    std::string result = fmt::format(R"({{"stream_bytes": {})", stream.size());
+    const size_t chunk_sizes[] = {1, 64, 1024};
+    for (size_t chunk_size : chunk_sizes) {
+        unpack_data_t unpack_data_obj;
+        protocol_initialize_unpack_object(&unpack_data_obj);
+        uint64_t frames = 0;
+        size_t processed = 0;
+        auto start = Clock::now();
+        while (seconds_since(start) < 0.3) {
+            for (size_t offset = 0; offset < stream.size(); offset += chunk_size) {
+                frames += protocol_unpack_buffer(&unpack_data_obj, stream.data() + offset,
+                                                 std::min(chunk_size, stream.size() - offset),
+                                                 [](void *, uint16_t, const uint8_t *, uint16_t) {}, nullptr);
+            }
+            processed += stream.size();
+        }
+        double elapsed = seconds_since(start);
+        result += fmt::format(R"(, "chunk_{}": {{"mb_per_s": {:.1f}, "frames_per_s": {:.0f}}})",
+                              chunk_size, processed / elapsed / 1e6, frames / elapsed);
+    }
+    return result + "}";
+}
+
+static std::string crc_throughput() {
+    std::mt19937 rng(42);
+    std::vector<uint8_t> data(1 << 16);
+    for (auto &b : data) {
+        b = (uint8_t) rng();
+    }
+
+    std::string result = fmt::format(R"({{"crc32_implementation": "{}")", get_crc32_implementation());
+    const size_t block_sizes[] = {16, 128, 4096};
+    for (size_t block_size : block_sizes) {
+        volatile uint32_t sink = 0;
+        double mbps[2];
+        for (int crc = 0; crc < 2; ++crc) {
+            size_t processed = 0;
+            auto start = Clock::now();
+            while (seconds_since(start) < 0.2) {
+                for (size_t offset = 0; offset + block_size <= data.size(); offset += block_size) {
+                    sink = sink + (crc == 0 ? get_crc16(data.data() + offset, (uint32_t) block_size)
+                                            : get_crc32(data.data() + offset, (uint32_t) block_size));
+                }
+                processed += data.size() / block_size * block_size;
+            }
+            mbps[crc] = processed / seconds_since(start) / 1e6;
+        }
+        result += fmt::format(R"(, "block_{}": {{"crc16_mb_per_s": {:.1f}, "crc32_mb_per_s": {:.1f}}})",
+                              block_size, mbps[0], mbps[1]);
+    }
+    return result + "}";
+}
+
+static std::string dispatch_overhead() {
+    DispatchTable dispatch_table;
+    volatile uint32_t sink = 0;
+    dispatch_table.set(CMD_LINEAR_ACTUATOR_RESPONSE, [&sink](const uint8_t *, uint16_t len) {
+        sink = sink + len;
+    });
+    uint8_t data[sizeof(cmd_linear_actuator_feedback_t)] = {};
+
+    const uint64_t iterations = 10000000;
+    auto start = Clock::now();
+    for (uint64_t i = 0; i < iterations; ++i) {
+        dispatch_table.dispatch(CMD_LINEAR_ACTUATOR_RESPONSE, data, sizeof(data));
+    }
+    double hit_ns = seconds_since(start) * 1e9 / iterations;
+
+    start = Clock::now();
+    for (uint64_t i = 0; i < iterations; ++i) {
+        dispatch_table.dispatch(CMD_CONSOLE_OUTPUT, data, sizeof(data));
+    }
+    double miss_ns = seconds_since(start) * 1e9 / iterations;
+
+    return fmt::format(R"({{"handler_ns_per_frame": {:.2f}, "no_handler_ns_per_frame": {:.2f}}})", hit_ns, miss_ns);
+}
+
+int main(int argc, char *argv[]) {
+    std::string port;
+    std::string stream_file;
+    std::string output_file;
+    SimulatedDeviceOptions device_options;
+    for (int i = 1; i < argc; i += 2) {
+        if (strcmp(argv[i], "--help") == 0) {
+            std::cout << "Usage: " << argv[0]
+                      << " [--port PORT] [--latency-us US] [--stream FILE] [--output FILE]" << std::endl;
+            return 0;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for option " << argv[i] << std::endl;
+            return 1;
+        }
+        if (strcmp(argv[i], "--port") == 0) {
+            port = argv[i + 1];
+        } else if (strcmp(argv[i], "--latency-us") == 0) {
+            device_options.latency = std::chrono::microseconds(std::stoll(argv[i + 1]));
+        } else if (strcmp(argv[i], "--stream") == 0) {
+            stream_file = argv[i + 1];
+        } else if (strcmp(argv[i], "--output") == 0) {
+            output_file = argv[i + 1];
+        } else {
+            std::cerr << "Unknown option " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<uint8_t> stream;
+    if (stream_file.empty()) {
+        stream = generate_stream(1 << 20);
+    } else {
+        // A capture file contributes its RX bytes, anything else is taken as a raw byte stream.
+        CaptureReader reader;
+        if (reader.open(stream_file)) {
+            CaptureRecord record;
+            while (reader.next(record)) {
+                if (record.direction == CaptureDirection::RX) {
+                    stream.insert(stream.end(), record.data.begin(), record.data.end());
+                }
+            }
+        } else {
+            std::ifstream file(stream_file, std::ios::binary);
+            stream.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+        if (stream.empty()) {
+            std::cerr << "Cannot read stream " << stream_file << std::endl;
+            return 1;
+        }
+    }
+
+    std::unique_ptr<SimulatedDevice> device;
+    std::unique_ptr<Transport> transport;
+    if (port.empty()) {
+        device.reset(new SimulatedDevice(device_options));
+        transport = device->host_transport();
+    } else {
+        transport.reset(new SerialTransport(port));
+    }
+    std::string transport_name = port.empty() ? "loopback" : port;
+
+    std::string sdk_results;
+    {
+        HumanoidSDK sdk(std::move(transport));
+        auto start = Clock::now();
+        while (!sdk.is_connected() && seconds_since(start) < 5.0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        if (!sdk.is_connected()) {
+            std::cerr << "Cannot connect to " << transport_name << std::endl;
+            return 1;
+        }
+        sdk_results += fmt::format(R"(  "rpc_round_trip": {},)", rpc_round_trip(sdk)) + "\n";
+        sdk_results += fmt::format(R"(  "broadcast_throughput": {},)", broadcast_throughput(sdk)) + "\n";
+    }
+    if (port.empty()) {
+        sdk_results += fmt::format(R"(  "rpc_under_polling": {},)", rpc_under_polling(device_options)) + "\n";
+    }
+
+    std::string json = "{\n";
+    json += fmt::format(R"(  "transport": "{}",)", transport_name) + "\n";
+    json += fmt::format(R"(  "device_latency_us": {},)", port.empty() ? device_options.latency.count() : -1) + "\n";
+    json += sdk_results;
+    json += fmt::format(R"(  "unpacker": {},)", unpacker_throughput(stream)) + "\n";
+    json += fmt::format(R"(  "crc": {},)", crc_throughput()) + "\n";
+    json += fmt::format(R"(  "dispatch": {})", dispatch_overhead()) + "\n";
+    json += "}\n";
+
+    if (output_file.empty()) {
+        std::cout << json;
+    } else {
+        std::ofstream(output_file) << json;
+    }
+    return 0;
+}
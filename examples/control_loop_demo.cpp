@@ -0,0 +1,32 @@
+#include <iostream>
+#include <chrono>
+#include "humanoid_sdk.h"
+
+
+int main(int argc, char* argv[]) {
+    humanoid_sdk::HumanoidSDK& sdk = humanoid_sdk::HumanoidSDK::get_instance();
+
+    std::vector<uint8_t> ids{1, 2, 3};
+    std::vector<uint16_t> targets{1000, 1000, 1000};
+
+    humanoid_sdk::ControlLoopOptions options;
+    options.period = std::chrono::milliseconds(2);
+    options.realtime_priority = 80;
+
+    humanoid_sdk::ControlLoop loop([&]() {
+        if (sdk.is_connected()) {
+            sdk.linear_actuator_broadcast_follows(ids, targets);
+        }
+    }, options);
+    loop.start();
+
+    while (true) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        auto statistics = loop.get_statistics();
+        std::cout << statistics.iterations << " iterations, "
+                  << statistics.overruns << " overruns, max wake-up latency "
+                  << std::chrono::duration<double, std::micro>(statistics.max_wakeup_latency).count() << " us" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,139 @@
+#ifndef HUMANOID_SDK_CAPTURE_H
+#define HUMANOID_SDK_CAPTURE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "transport.h"
+
+namespace humanoid_sdk {
+
+    // Capture file: the 8 byte magic "HSDKCAP1", then records of a little-endian header
+    // (uint64 nanoseconds since the start of the capture, uint8 direction, uint16 length) followed by the bytes.
+    enum class CaptureDirection : uint8_t {
+        RX = 0,
+        TX = 1
+    };
+
+    struct CaptureRecord {
+        std::chrono::nanoseconds timestamp;
+        CaptureDirection direction;
+        std::vector<uint8_t> data;
+    };
+
+    // Tees raw bytes into a capture file. RX and TX each have a preallocated single-producer ring, a background
+    // thread drains them to disk, so record() never blocks. Bytes that do not fit in the ring are dropped and counted.
+    class CaptureRecorder {
+    public:
+        explicit CaptureRecorder(size_t ring_capacity = 1 << 20);
+
+        ~CaptureRecorder();
+
+        CaptureRecorder(CaptureRecorder const&) = delete;
+        void operator=(CaptureRecorder const&) = delete;
+
+        // Start writing to path, an existing file is replaced. Returns false if the file cannot be created.
+        bool start(const std::string &path);
+
+        void stop();
+
+        // Call from one thread per direction (the RX thread for RX, the writer thread for TX).
+        void record(CaptureDirection direction, const uint8_t *data, size_t len);
+
+        uint64_t dropped_bytes() const;
+
+    private:
+        static constexpr size_t RECORD_HEADER_SIZE = 11;
+
+        struct Ring {
+            std::unique_ptr<uint8_t[]> buffer;
+            std::atomic<size_t> head{0};
+            std::atomic<size_t> tail{0};
+        };
+
+        size_t ring_capacity;
+        Ring rings[2];
+        std::atomic<bool> enabled;
+        std::atomic<uint64_t> dropped;
+        int64_t start_ticks;
+
+        std::mutex writer_mutex;
+        std::condition_variable writer_condition_variable;
+        bool writer_running;
+        std::thread writer_thread;
+        std::FILE *file;
+
+        void writer_thread_function();
+
+        // Write every complete record of both rings in timestamp order, returns false once nothing is left.
+        bool drain();
+
+        void ring_read(Ring &ring, size_t pos, uint8_t *out, size_t len);
+    };
+
+    // Reads a capture file record by record.
+    class CaptureReader {
+    public:
+        CaptureReader();
+
+        ~CaptureReader();
+
+        CaptureReader(CaptureReader const&) = delete;
+        void operator=(CaptureReader const&) = delete;
+
+        bool open(const std::string &path);
+
+        // Returns false at the end of the file or on a truncated record.
+        bool next(CaptureRecord &record);
+
+    private:
+        std::FILE *file;
+    };
+
+    // Feeds the RX bytes of a capture to the SDK as if they came from a board, at the original pace or as fast as
+    // possible. Writes are discarded.
+    class ReplayTransport : public Transport {
+    public:
+        ReplayTransport(const std::string &path, bool original_speed);
+
+        bool open() override;
+
+        void close() override;
+
+        bool is_open() override;
+
+        std::string name() override;
+
+        bool wait_readable() override;
+
+        size_t available() override;
+
+        size_t read(uint8_t *buffer, size_t size) override;
+
+        size_t write(const uint8_t *data, size_t size) override;
+
+        // True once every record has been read.
+        bool finished();
+
+    private:
+        std::string path;
+        bool original_speed;
+        std::atomic<bool> opened;
+        std::mutex mutex;
+        std::vector<CaptureRecord> records;
+        size_t next_record;
+        size_t next_offset;
+        std::chrono::steady_clock::time_point replay_start;
+
+        bool record_due();
+    };
+}
+
+#endif //HUMANOID_SDK_CAPTURE_H
@@ -0,0 +1,55 @@
+#ifndef HUMANOID_SDK_CONSOLE_BUFFER_H
+#define HUMANOID_SDK_CONSOLE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace humanoid_sdk {
+
+    // Fixed-capacity byte ring for the firmware console output.
+    // The RX thread writes without locking or allocating; bytes that do not fit are dropped and counted, so a
+    // flood of debug output can neither stall the receive path nor grow the process. Readers are serialized among
+    // themselves by a mutex the writer never takes.
+    class ConsoleBuffer {
+    public:
+        // capacity is rounded up to a power of two.
+        explicit ConsoleBuffer(size_t capacity);
+
+        ConsoleBuffer(ConsoleBuffer const&) = delete;
+        void operator=(ConsoleBuffer const&) = delete;
+
+        // Writer only.
+        void write(const uint8_t *data, size_t len);
+
+        // Replace s with everything buffered and consume it.
+        size_t read(std::string &s);
+
+        // Consume the next complete line without its '\n' (and '\r'). Returns false if no line is complete, except
+        // when the ring is full without a line break, then the whole content is returned as one line.
+        bool read_line(std::string &line);
+
+        // Bytes currently buffered.
+        size_t size() const;
+
+        // Bytes lost because the ring was full.
+        uint64_t dropped_bytes() const;
+
+    private:
+        std::unique_ptr<char[]> buffer;
+        size_t mask;
+        char padding0[64];
+        std::atomic<size_t> head;
+        char padding1[64];
+        std::atomic<size_t> tail;
+        std::atomic<uint64_t> dropped;
+        std::mutex reader_mutex;
+
+        // Copy len bytes starting at position pos, which may wrap.
+        void copy_out(size_t pos, size_t len, std::string &out) const;
+    };
+}
+
+#endif //HUMANOID_SDK_CONSOLE_BUFFER_H
@@ -0,0 +1,82 @@
+#ifndef HUMANOID_SDK_CONTROL_LOOP_H
+#define HUMANOID_SDK_CONTROL_LOOP_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace humanoid_sdk {
+
+    struct ControlLoopOptions {
+        std::chrono::nanoseconds period{std::chrono::milliseconds(2)};
+        // SCHED_FIFO priority of the loop thread (1-99), 0 keeps the default scheduler. Linux only.
+        int realtime_priority{0};
+        // Pin the loop thread to this CPU, -1 leaves it unpinned. Linux only.
+        int cpu{-1};
+    };
+
+    struct ControlLoopStatistics {
+        // Bucket 0 counts wake-ups under 1 us late, bucket i counts [2^(i-1), 2^i) us, the last bucket is open-ended.
+        static constexpr size_t HISTOGRAM_BUCKETS = 24;
+
+        uint64_t iterations;
+        // Steps that ended after the next deadline, the missed periods are skipped.
+        uint64_t overruns;
+        uint64_t skipped_periods;
+        std::chrono::nanoseconds max_wakeup_latency;
+        std::chrono::nanoseconds mean_wakeup_latency;
+        std::chrono::nanoseconds max_step_duration;
+        std::vector<uint64_t> wakeup_latency_histogram;
+    };
+
+    // Runs a step function at a fixed rate on a dedicated thread, sleeping to absolute deadlines so the
+    // period does not drift with the step duration. SDK calls made from the step queue their frames for the
+    // transmission thread and return without waiting for the serial write.
+    class ControlLoop {
+    public:
+        ControlLoop(std::function<void(void)> step, const ControlLoopOptions &options);
+
+        ~ControlLoop();
+
+        ControlLoop(ControlLoop const&) = delete;
+        void operator=(ControlLoop const&) = delete;
+
+        // Returns false if the loop is already running.
+        bool start();
+
+        // Waits for the current step to return, must not be called from the step itself.
+        void stop();
+
+        bool is_running() const;
+
+        ControlLoopStatistics get_statistics() const;
+
+        void reset_statistics();
+
+    private:
+        std::function<void(void)> step;
+        ControlLoopOptions options;
+
+        std::atomic<bool> running;
+        std::thread loop_thread;
+
+        std::atomic<uint64_t> iterations;
+        std::atomic<uint64_t> overruns;
+        std::atomic<uint64_t> skipped_periods;
+        std::atomic<int64_t> max_wakeup_latency_ns;
+        std::atomic<int64_t> total_wakeup_latency_ns;
+        std::atomic<int64_t> max_step_duration_ns;
+        std::atomic<uint64_t> wakeup_latency_histogram[ControlLoopStatistics::HISTOGRAM_BUCKETS];
+
+        void loop_thread_function();
+
+        void configure_thread();
+
+        void record_wakeup(int64_t latency_ns);
+    };
+}
+
+#endif //HUMANOID_SDK_CONTROL_LOOP_H
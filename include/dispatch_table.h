@@ -0,0 +1,54 @@
+#ifndef HUMANOID_SDK_DISPATCH_TABLE_H
+#define HUMANOID_SDK_DISPATCH_TABLE_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace humanoid_sdk {
+
+    // Frame handler, data points into the receive buffer and is only valid during the call.
+    using FrameCallback = std::function<void(const uint8_t *data, uint16_t len)>;
+
+    // cmd_id -> handler table indexed by the high and low byte of the cmd_id.
+    // dispatch() never takes a lock: handlers are swapped with atomic pointers and the old handler is
+    // freed once no dispatch is running (RCU style). set() and remove() are serialized among themselves.
+    class DispatchTable {
+    public:
+        DispatchTable();
+
+        ~DispatchTable();
+
+        DispatchTable(DispatchTable const&) = delete;
+        void operator=(DispatchTable const&) = delete;
+
+        void set(uint16_t cmd_id, FrameCallback callback);
+
+        void remove(uint16_t cmd_id);
+
+        // Run the handler of cmd_id, returns false if there is none.
+        bool dispatch(uint16_t cmd_id, const uint8_t *data, uint16_t len);
+
+    private:
+        struct Group {
+            std::atomic<FrameCallback *> handlers[256];
+        };
+
+        std::atomic<Group *> groups[256];
+        std::atomic<uint32_t> epoch;
+        std::atomic<uint32_t> active_dispatches[2];
+        std::mutex grace_mutex;
+
+        std::mutex writer_mutex;
+        // Handlers replaced from inside a dispatch, freed by the next writer outside of one.
+        std::vector<FrameCallback *> retired_handlers;
+
+        void replace(uint16_t cmd_id, FrameCallback *handler);
+
+        void wait_for_dispatches();
+    };
+}
+
+#endif //HUMANOID_SDK_DISPATCH_TABLE_H
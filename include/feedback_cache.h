@@ -0,0 +1,41 @@
+#ifndef HUMANOID_SDK_FEEDBACK_CACHE_H
+#define HUMANOID_SDK_FEEDBACK_CACHE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "protocol_definition.h"
+
+namespace humanoid_sdk {
+
+    // Latest linear actuator feedback per actuator id with its receive time.
+    // A single thread updates (the RX thread), any number of threads read without locking (seqlock).
+    class FeedbackCache {
+    public:
+        FeedbackCache();
+
+        FeedbackCache(FeedbackCache const&) = delete;
+        void operator=(FeedbackCache const&) = delete;
+
+        // Writer only.
+        void update(const cmd_linear_actuator_feedback_t &feedback, std::chrono::steady_clock::time_point timestamp);
+
+        // Returns false if nothing has been received from this id yet.
+        bool read(uint8_t id, cmd_linear_actuator_feedback_t &feedback,
+                  std::chrono::steady_clock::time_point &timestamp) const;
+
+    private:
+        static constexpr size_t PAYLOAD_WORDS = (sizeof(cmd_linear_actuator_feedback_t) + 7) / 8;
+
+        struct alignas(64) Entry {
+            // Odd while an update is in progress, 0 until the first update.
+            std::atomic<uint32_t> sequence;
+            std::atomic<int64_t> timestamp;
+            std::atomic<uint64_t> payload[PAYLOAD_WORDS];
+        };
+
+        Entry entries[256];
+    };
+}
+
+#endif //HUMANOID_SDK_FEEDBACK_CACHE_H
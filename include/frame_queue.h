@@ -0,0 +1,60 @@
+#ifndef HUMANOID_SDK_FRAME_QUEUE_H
+#define HUMANOID_SDK_FRAME_QUEUE_H
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include "protocol_lite.h"
+
+namespace humanoid_sdk {
+
+    // Bounded lock-free queue of packed protocol frames.
+    // Any number of threads may push, a single thread pops (multi-producer, single-consumer).
+    class FrameQueue {
+    public:
+        // capacity is rounded up to a power of two.
+        explicit FrameQueue(size_t capacity);
+
+        FrameQueue(FrameQueue const&) = delete;
+        void operator=(FrameQueue const&) = delete;
+
+        // Pack a frame directly into a free slot, returns false if the queue is full.
+        bool push(uint16_t cmd_id, const uint8_t *p_data, uint16_t len);
+
+        // Queue several frames all or none: reserve count consecutive slots starting at pos, fill each with pack(),
+        // then publish() them together. Returns false, reserving nothing, if fewer than count slots are free.
+        bool reserve(size_t count, size_t &pos);
+
+        void pack(size_t pos, uint16_t cmd_id, const uint8_t *p_data, uint16_t len);
+
+        // The slots become visible to the consumer at once, whole frames up to the first of them are popped
+        // together.
+        void publish(size_t pos, size_t count);
+
+        // Consumer only: move as many whole frames as fit into buffer, returns the number of bytes written.
+        size_t pop_frames(uint8_t *buffer, size_t buffer_size);
+
+        bool empty() const;
+
+        // Approximate number of queued frames.
+        size_t size() const;
+
+    private:
+        struct Slot {
+            std::atomic<size_t> sequence;
+            uint16_t frame_size;
+            uint8_t frame[PROTOCOL_FRAME_MAX_SIZE];
+        };
+
+        std::unique_ptr<Slot[]> slots;
+        size_t mask;
+        // Keep producer and consumer positions on separate cache lines.
+        char padding0[64];
+        std::atomic<size_t> enqueue_pos;
+        char padding1[64];
+        std::atomic<size_t> dequeue_pos;
+    };
+}
+
+#endif //HUMANOID_SDK_FRAME_QUEUE_H
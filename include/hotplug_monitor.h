@@ -0,0 +1,44 @@
+#ifndef HUMANOID_SDK_HOTPLUG_MONITOR_H
+#define HUMANOID_SDK_HOTPLUG_MONITOR_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace humanoid_sdk {
+
+    struct HotplugEvent {
+        // Device node name relative to the watched directory, e.g. "ttyACM0".
+        std::string name;
+        // The node was deleted, otherwise it was created or its attributes (permissions) changed.
+        bool removed;
+    };
+
+    // Watches a device directory with inotify for tty nodes coming and going, so a board is reopened as soon as
+    // its node appears and nothing has to be enumerated while no device changes. Linux only, elsewhere
+    // available() is false and wait() merely sleeps.
+    class HotplugMonitor {
+    public:
+        explicit HotplugMonitor(const std::string &directory = "/dev");
+
+        ~HotplugMonitor();
+
+        HotplugMonitor(HotplugMonitor const&) = delete;
+        void operator=(HotplugMonitor const&) = delete;
+
+        bool available() const;
+
+        // Block until device events are pending or timeout elapses, returns true if events are pending.
+        bool wait(std::chrono::milliseconds timeout);
+
+        // Consume the pending events of tty nodes, never blocks. overflowed is set if the kernel queue overflowed
+        // since the last call (e.g. nobody read it during a long connection), then events are missing and the
+        // caller has to enumerate the devices again.
+        std::vector<HotplugEvent> read_events(bool &overflowed);
+
+    private:
+        int inotify_fd;
+    };
+}
+
+#endif //HUMANOID_SDK_HOTPLUG_MONITOR_H
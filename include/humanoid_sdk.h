@@ -8,16 +8,26 @@
 #include <functional>
 #include <mutex>
 #include <condition_variable>
-#include <unordered_map>
-#include <sstream>
+#include <deque>
 #include "serial/serial.h"
+#include "transport.h"
 #include "protocol_lite.h"
 #include "timer.h"
+#include "frame_queue.h"
+#include "dispatch_table.h"
+#include "control_loop.h"
+#include "feedback_cache.h"
+#include "subscription.h"
+#include "metrics.h"
+#include "capture.h"
+#include "console_buffer.h"
+#include "thread_affinity.h"
 #include "fmt/format.h"
 #include "protocol_definition.h"
 
 namespace humanoid_sdk {
 
+    // Copying handler kept for compatibility, prefer FrameCallback on the receive path.
     using ReceivedCallback = std::function<void(const std::vector<uint8_t> &)>;
 
     struct LinearActuatorFeedback {
@@ -31,15 +41,76 @@ namespace humanoid_sdk {
         uint16_t internal_data2;
     };
 
+    struct LinearActuatorSample {
+        std::chrono::steady_clock::time_point timestamp;
+        LinearActuatorFeedback feedback;
+    };
+
+    using FrameSubscription = SubscriptionQueue<ReceivedFrame>;
+
+    using LinearActuatorSubscription = SubscriptionQueue<LinearActuatorSample>;
+
+    // Completion callback of an asynchronous linear actuator command, feedback is only valid when success is true.
+    // Callbacks run on an SDK thread and must not block.
+    using LinearActuatorCallback = std::function<void(bool success, const LinearActuatorFeedback &feedback)>;
+
+    // Console output as it arrives, called on the RX thread with each chunk, must not block.
+    using ConsoleCallback = std::function<void(const char *data, size_t len)>;
+
+    // Completion callbacks of the asynchronous board queries, the value is only valid when success is true.
+    using UidCallback = std::function<void(bool success, const std::string &uid)>;
+
+    using TemperatureCallback = std::function<void(bool success, float temperature)>;
+
+    // Identifies an asynchronous request, see HumanoidSDK::cancel_rpc().
+    using RpcHandle = uint64_t;
+
+    struct CommunicationStatistics {
+        uint64_t rx_bytes;
+        uint64_t rx_read_calls;
+        uint64_t tx_bytes;
+        uint64_t tx_write_calls;
+        uint64_t tx_dropped_frames;
+
+        // Average number of bytes returned by each read syscall on the receive path.
+        double rx_bytes_per_read() const {
+            return rx_read_calls == 0 ? 0.0 : (double)rx_bytes / (double)rx_read_calls;
+        }
+
+        // Average number of bytes coalesced into each write syscall on the transmit path.
+        double tx_bytes_per_write() const {
+            return tx_write_calls == 0 ? 0.0 : (double)tx_bytes / (double)tx_write_calls;
+        }
+    };
+
+    struct HumanoidSDKOptions {
+        // Board selection, see SerialTransportOptions. Empty fields match any board.
+        std::string port;
+        std::string serial_number;
+        std::string uid;
+        // Pin the RX / TX threads to a CPU, -1 leaves them unpinned. Linux only.
+        int rx_cpu{-1};
+        int tx_cpu{-1};
+    };
+
+    // One instance per board, each with its own RX and TX threads, so several boards run in parallel.
     class HumanoidSDK {
 
     public:
+        // Shared instance bound to the first board found, for code written before multi-board support.
         static HumanoidSDK& get_instance()
         {
-            static HumanoidSDK instance;
+            static HumanoidSDK instance{HumanoidSDKOptions()};
             return instance;
         }
 
+        explicit HumanoidSDK(const HumanoidSDKOptions &options);
+
+        // Talk to a board over any transport, e.g. the loopback of a SimulatedDevice.
+        // Only the thread options of options are used.
+        explicit HumanoidSDK(std::unique_ptr<Transport> transport,
+                             const HumanoidSDKOptions &options = HumanoidSDKOptions());
+
         HumanoidSDK(HumanoidSDK const&) = delete;
         void operator=(HumanoidSDK const&) = delete;
 
@@ -47,10 +118,26 @@ namespace humanoid_sdk {
 
         bool is_connected();
 
+        CommunicationStatistics get_communication_statistics();
+
+        // Record the raw RX/TX byte stream to a capture file, see ReplayTransport to play it back.
+        bool start_capture(const std::string &path);
+
+        void stop_capture();
+
+        // Counters and RPC latency histograms collected on the I/O paths since construction.
+        Metrics get_metrics();
+
         bool read_uid(std::string &uid);
 
         bool read_temperature(float &temperature);
 
+        RpcHandle read_uid_async(UidCallback callback,
+                                 const std::chrono::milliseconds &timeout = std::chrono::milliseconds(100));
+
+        RpcHandle read_temperature_async(TemperatureCallback callback,
+                                         const std::chrono::milliseconds &timeout = std::chrono::milliseconds(100));
+
         bool linear_actuator_set_target(uint8_t id, uint16_t target, LinearActuatorFeedback &feedback);
 
         bool linear_actuator_follow(uint8_t id, uint16_t target, LinearActuatorFeedback &feedback);
@@ -67,57 +154,305 @@ namespace humanoid_sdk {
 
         bool linear_actuator_clear_error(uint8_t id, LinearActuatorFeedback &feedback);
 
+        // Query several actuators with one serial write and gather the responses as they arrive.
+        // Returns per-id success, feedbacks[i] is only valid when the i-th entry is true.
+        std::vector<bool> linear_actuator_query_states(const std::vector<uint8_t> &ids,
+                                                       std::vector<LinearActuatorFeedback> &feedbacks,
+                                                       const std::chrono::milliseconds &timeout = std::chrono::milliseconds(100));
+
+        // Latest feedback received from an actuator, solicited or not, without a round trip.
+        // timestamp is the receive time, returns false if nothing has been received from this id yet.
+        bool linear_actuator_cached_state(uint8_t id, LinearActuatorFeedback &feedback,
+                                          std::chrono::steady_clock::time_point &timestamp);
+
+        // Cached feedback no older than max_age, returns false if it is missing or stale.
+        bool linear_actuator_cached_state(uint8_t id, LinearActuatorFeedback &feedback,
+                                          const std::chrono::milliseconds &max_age);
+
+        // Let the SDK query the state of ids round-robin at rate_hz queries per second in total, the responses
+        // only update the feedback cache. The rate is capped to a share of the serial bandwidth and polls are
+        // held back while other frames are queued. Replaces any previous polling configuration.
+        void linear_actuator_start_polling(const std::vector<uint8_t> &ids, double rate_hz);
+
+        void linear_actuator_stop_polling();
+
+        // Non-blocking variants, the callback is invoked once with the response or on timeout.
+
+        RpcHandle linear_actuator_set_target_async(uint8_t id, uint16_t target, LinearActuatorCallback callback,
+                                                   const std::chrono::milliseconds &timeout = std::chrono::milliseconds(100));
+
+        RpcHandle linear_actuator_follow_async(uint8_t id, uint16_t target, LinearActuatorCallback callback,
+                                               const std::chrono::milliseconds &timeout = std::chrono::milliseconds(100));
+
+        RpcHandle linear_actuator_enable_async(uint8_t id, LinearActuatorCallback callback,
+                                               const std::chrono::milliseconds &timeout = std::chrono::milliseconds(100));
+
+        RpcHandle linear_actuator_stop_async(uint8_t id, LinearActuatorCallback callback,
+                                             const std::chrono::milliseconds &timeout = std::chrono::milliseconds(100));
+
+        RpcHandle linear_actuator_pause_async(uint8_t id, LinearActuatorCallback callback,
+                                              const std::chrono::milliseconds &timeout = std::chrono::milliseconds(100));
+
+        RpcHandle linear_actuator_save_parameters_async(uint8_t id, LinearActuatorCallback callback,
+                                                        const std::chrono::milliseconds &timeout = std::chrono::milliseconds(100));
+
+        RpcHandle linear_actuator_query_state_async(uint8_t id, LinearActuatorCallback callback,
+                                                    const std::chrono::milliseconds &timeout = std::chrono::milliseconds(100));
+
+        RpcHandle linear_actuator_clear_error_async(uint8_t id, LinearActuatorCallback callback,
+                                                    const std::chrono::milliseconds &timeout = std::chrono::milliseconds(100));
+
+        // Drop a pending asynchronous request without invoking its callback.
+        // Returns false if the request already completed or its callback is running.
+        bool cancel_rpc(RpcHandle handle);
+
+        // Copy every received frame with cmd_id into a queue the caller drains from its own thread.
+        // Subscriptions stay active until unsubscribe(), the RX thread only pays a copy per subscriber.
+        // Subscribing and unsubscribing wait for the RX thread to leave the subscription handlers, so the consumer
+        // of a BLOCK subscription must not call them while its queue may be full, see OverflowPolicy::BLOCK.
+        std::shared_ptr<FrameSubscription> subscribe(uint16_t cmd_id, size_t capacity = 256,
+                                                     OverflowPolicy policy = OverflowPolicy::DROP_OLDEST);
+
+        // Every feedback received from actuator id, solicited or not (e.g. polling responses).
+        std::shared_ptr<LinearActuatorSubscription> subscribe_linear_actuator(uint8_t id, size_t capacity = 256,
+                                                                              OverflowPolicy policy = OverflowPolicy::DROP_OLDEST);
+
+        // Stop and close a subscription, elements already queued can still be popped.
+        void unsubscribe(const std::shared_ptr<FrameSubscription> &subscription);
+
+        void unsubscribe(const std::shared_ptr<LinearActuatorSubscription> &subscription);
+
         bool write_console(const std::string &s);
 
+        // Everything the firmware printed since the last call. Output beyond the buffer capacity is dropped,
+        // see Metrics::console_dropped_bytes.
         bool console_output(std::string& s);
 
+        // Consume the next complete line of console output, returns false if there is none yet.
+        bool console_read_line(std::string &line);
+
+        // Also hand console output to callback as it arrives, nullptr removes it. The buffer is filled either way.
+        void set_console_callback(ConsoleCallback callback);
+
         bool set_maestro_channel(uint8_t channel, uint16_t target);
 
+        // Only channels whose target differs from the last one sent are transmitted.
         bool set_maestro_all_channel(const std::vector<uint16_t>& targets);
 
+        // Buffer a Maestro target, nothing is sent until maestro_flush().
+        void maestro_set_target(uint8_t channel, uint16_t target);
+
+        // Send the buffered targets that changed since the last flush with the cheapest encoding:
+        // one frame per channel, a masked multi-channel frame or all channels.
+        bool maestro_flush();
+
         bool linear_actuator_set_target_silent(uint8_t id, uint16_t target);
 
         bool linear_actuator_follow_silent(uint8_t id, uint16_t target);
 
+        // Any number of actuators, split into as many frames as needed. The frames are queued all or none and leave
+        // in one write as long as they fit the TX buffer. Returns false if the TX queue has no room for all of them.
         bool linear_actuator_broadcast_targets(const std::vector<uint8_t>& ids, const std::vector<uint16_t>& targets);
 
         bool linear_actuator_broadcast_follows(const std::vector<uint8_t>& ids, const std::vector<uint16_t>& targets);
 
+        // Same as above for count actuators read from plain arrays, e.g. the buffers of NumPy arrays.
+        bool linear_actuator_broadcast_targets(const uint8_t *ids, const uint16_t *targets, size_t count);
+
+        bool linear_actuator_broadcast_follows(const uint8_t *ids, const uint16_t *targets, size_t count);
+
     private:
-        HumanoidSDK();
+        static constexpr size_t RX_BUFFER_SIZE = 1024;
+        static constexpr size_t TX_BUFFER_SIZE = 4096;
+        static constexpr size_t TX_QUEUE_CAPACITY = 256;
+        static constexpr size_t CONSOLE_BUFFER_SIZE = 64 * 1024;
+        // Bandwidth budget of the link, also used for loopback transports.
+        static constexpr uint32_t SERIAL_BAUDRATE = 921600;
+        static constexpr size_t MAESTRO_CHANNELS = 24;
+        // Polling never uses more than this share of the serial bandwidth.
+        static constexpr double POLLING_MAX_BUS_SHARE = 0.25;
+        // Polls wait while more frames than this are queued for transmission.
+        static constexpr size_t POLLING_MAX_TX_BACKLOG = 4;
+        // A poll unanswered for four smoothed poll round trips, bounded by these, is considered lost. Afterwards the
+        // actuator may be polled again and its next response completes an RPC.
+        static constexpr std::chrono::milliseconds POLLING_RESPONSE_TIMEOUT_MIN{10};
+        static constexpr std::chrono::milliseconds POLLING_RESPONSE_TIMEOUT{100};
+
+        using RpcCallback = std::function<void(bool success, const uint8_t *p_data, uint16_t len)>;
+
+        struct PendingRpc {
+            enum State { FREE, WAITING, COMPLETING };
+            State state{FREE};
+            uint32_t key{0};
+            RpcHandle handle{0};
+            std::chrono::steady_clock::time_point start;
+            std::chrono::steady_clock::time_point deadline;
+            LatencyHistogram *latency{nullptr};
+            RpcCallback callback;
+            // A linear actuator request held back while a poll of the actuator is outstanding, sent once the poll
+            // is answered or lost. Otherwise a lost poll would take the response of the request.
+            bool deferred{false};
+            uint16_t request_cmd_id{0};
+            uint16_t request_size{0};
+            uint8_t request[PROTOCOL_DATA_MAX_SIZE];
+        };
 
         std::atomic<bool> is_running;
-        serial::Serial serial_port;
+        std::atomic<uint64_t> rx_bytes;
+        std::atomic<uint64_t> rx_read_calls;
+        std::atomic<uint64_t> tx_bytes;
+        std::atomic<uint64_t> tx_write_calls;
+        std::atomic<uint64_t> tx_dropped_frames;
+        std::atomic<uint64_t> rx_frames;
+        std::atomic<uint64_t> tx_frames;
+        std::atomic<uint64_t> crc8_errors;
+        std::atomic<uint64_t> crc16_errors;
+        std::atomic<uint64_t> resyncs;
+        std::atomic<uint64_t> rpc_timeouts;
+        std::atomic<uint64_t> serial_errors;
+        std::atomic<uint64_t> reconnects;
+        std::atomic<uint64_t> tx_queue_depth_max;
+        LatencyHistogram reconnect_time;
+        std::unique_ptr<Transport> transport;
+        int rx_cpu;
+        int tx_cpu;
         std::thread communication_thread;
+        // Frames from every thread are packed into tx_queue and written by transmission_thread alone.
+        FrameQueue tx_queue;
+        std::mutex tx_mutex;
+        std::condition_variable tx_condition_variable;
+        std::atomic<bool> tx_writer_sleeping;
+        std::thread transmission_thread;
         TimerManagement timer_management;
-        std::mutex callback_map_mutex;
-        std::unordered_map<uint16_t, ReceivedCallback> callback_map;
-        std::stringstream console_output_stream;
-
-        std::string scan_robot();
-
-        void connect(const std::string &port_name);
+        DispatchTable dispatch_table;
+        FeedbackCache feedback_cache;
+        // Subscribers are published to the RX thread through their own table, dispatched after dispatch_table.
+        // The lists below are the source of truth, guarded by subscription_mutex. Replacing a handler waits for the
+        // RX thread, which may wait on a full BLOCK queue, so it is done outside subscription_mutex (the destructor
+        // takes it to close the queues) and serialized by subscription_update_mutex instead.
+        DispatchTable subscription_table;
+        std::atomic<size_t> subscription_count;
+        std::mutex subscription_update_mutex;
+        std::mutex subscription_mutex;
+        std::multimap<uint16_t, std::shared_ptr<FrameSubscription>> frame_subscriptions;
+        std::vector<std::pair<uint8_t, std::shared_ptr<LinearActuatorSubscription>>> linear_actuator_subscriptions;
+        CaptureRecorder capture_recorder;
+        ConsoleBuffer console_buffer;
+        // Pending requests keyed by (response cmd_id, tag), the tag is the actuator id for linear actuator RPCs.
+        // Slots are reused and never move (deque), so callbacks can run outside the lock.
+        std::mutex pending_rpc_mutex;
+        std::deque<PendingRpc> pending_rpcs;
+        RpcHandle last_rpc_handle;
+        // Round trip per request cmd_id, entries are created under pending_rpc_mutex and never removed.
+        std::map<uint16_t, std::unique_ptr<LatencyHistogram>> rpc_latency;
+        // Maestro targets as last sent to the board and as buffered for the next flush.
+        std::mutex maestro_mutex;
+        uint16_t maestro_sent_targets[MAESTRO_CHANNELS];
+        uint16_t maestro_targets[MAESTRO_CHANNELS];
+        // Bit n is set when the board is known to hold maestro_sent_targets[n], cleared on reconnect.
+        uint32_t maestro_sent_mask;
+        uint32_t maestro_dirty_mask;
+        std::mutex polling_mutex;
+        std::vector<uint8_t> polling_ids;
+        size_t polling_cursor;
+        double polling_rate;
+        double polling_budget;
+        std::chrono::steady_clock::time_point polling_last_tick;
+        TimerManagement::TimerHandle polling_timer;
+        // Polls of each actuator id whose response has not arrived yet. Actuators answer in order, so exactly that
+        // many responses are consumed before one may complete an RPC.
+        std::atomic<uint32_t> outstanding_polls[256];
+        // When (steady_clock ticks) the outstanding poll of each actuator id was sent.
+        std::atomic<int64_t> poll_sent_at[256];
+        // Smoothed time (steady_clock ticks) from a poll to its response, 0 until one was answered. RX thread writes.
+        std::atomic<int64_t> poll_round_trip;
+        // PendingRpc::deferred requests, lets the RX thread skip pending_rpc_mutex while there are none.
+        std::atomic<uint32_t> deferred_rpc_count;
 
         void communication();
 
+        void transmission();
+
         void handle_serial_error(serial::IOException &e);
 
         void dispatch_frame(uint16_t cmd_id, const uint8_t *p_data, uint16_t len);
 
+        // Queue a frame and wake the writer thread.
         size_t send_cmd_with_data(uint16_t cmd_id, const uint8_t *p_data, uint16_t len);
 
+        // Queue a frame without waking the writer, call flush_tx_queue() after the last one of a batch.
+        size_t queue_cmd_with_data(uint16_t cmd_id, const uint8_t *p_data, uint16_t len);
+
+        void flush_tx_queue();
+
+        bool maestro_flush_locked();
+
+        void register_cmd_callback(uint16_t cmd_id, FrameCallback callback);
+
         void register_cmd_callback(uint16_t cmd_id, ReceivedCallback callback);
 
         void remove_cmd_callback(uint16_t cmd_id);
 
+        // Rebuild the subscription handler of cmd_id from the lists, subscription_update_mutex must be held and
+        // subscription_mutex must not.
+        void update_subscription_handler(uint16_t cmd_id);
+
+        static uint32_t rpc_key(uint16_t response_cmd_id, uint8_t response_tag) {
+            return ((uint32_t) response_cmd_id << 8) | response_tag;
+        }
+
+        // The caller sends the request unless deferred is set, then it is sent after the outstanding poll of the
+        // actuator, see PendingRpc::deferred.
+        RpcHandle register_rpc(uint16_t request_cmd_id, const void *request_data, uint16_t request_size,
+                               uint16_t response_cmd_id, uint8_t response_tag,
+                               const std::chrono::milliseconds &timeout, RpcCallback callback, bool &deferred);
+
+        RpcHandle rpc_call_async(uint16_t request_cmd_id,
+                                 const void *request_data,
+                                 uint16_t request_size,
+                                 uint16_t response_cmd_id,
+                                 uint8_t response_tag,
+                                 const std::chrono::milliseconds &timeout,
+                                 RpcCallback callback);
+
         bool rpc_call(uint16_t request_cmd_id,
                       const void *request_data,
                       uint16_t request_size,
                       uint16_t response_cmd_id,
+                      uint8_t response_tag,
                       void *response_data,
+                      uint16_t response_size,
                       const std::chrono::milliseconds &timeout);
 
-        void linear_actuator_response_to_feedback(cmd_linear_actuator_feedback_t& res, LinearActuatorFeedback& feedback);
+        void complete_rpc(uint16_t response_cmd_id, uint8_t response_tag, const uint8_t *p_data, uint16_t len);
+
+        // Fail the pending RPCs whose deadline is before now.
+        void expire_rpcs(std::chrono::steady_clock::time_point now);
+
+        void poll_linear_actuators();
+
+        // RX thread: true if this response answers an outstanding poll and must not complete an RPC.
+        bool consume_poll_response(uint8_t id);
+
+        // steady_clock ticks after which an unanswered poll is considered lost.
+        int64_t poll_timeout() const;
+
+        // Send the deferred requests of actuator id, its poll was answered or lost.
+        void send_deferred_rpcs(uint8_t id);
+
+        // Clear PendingRpc::deferred of a request that will never be sent, pending_rpc_mutex must be held.
+        void drop_deferred_request(PendingRpc &pending);
+
+        // Forget the polls lost before now and send the requests they held back.
+        void expire_polls(std::chrono::steady_clock::time_point now);
+
+        RpcHandle linear_actuator_rpc_call_async(uint16_t request_cmd_id, const void *request_data, uint16_t request_size,
+                                                 uint8_t id, LinearActuatorCallback callback,
+                                                 const std::chrono::milliseconds &timeout);
+
+        bool linear_actuator_broadcast(uint16_t cmd_id, const uint8_t *ids, const uint16_t *targets, size_t count);
+
+        static void linear_actuator_response_to_feedback(cmd_linear_actuator_feedback_t& res, LinearActuatorFeedback& feedback);
 
     };
 }
@@ -0,0 +1,73 @@
+#ifndef HUMANOID_SDK_METRICS_H
+#define HUMANOID_SDK_METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace humanoid_sdk {
+
+    struct LatencySnapshot {
+        uint64_t count;
+        std::chrono::microseconds mean;
+        std::chrono::microseconds max;
+        // Bucket counts, see LatencyHistogram::bucket_lower_bound().
+        std::vector<uint64_t> buckets;
+
+        // Upper bound of the bucket holding the p-th percentile (0-100), within 12.5%.
+        std::chrono::microseconds percentile(double p) const;
+    };
+
+    // Log-linear (HDR style) histogram of latencies in microseconds, 8 sub-buckets per power of two.
+    // record() is wait-free with relaxed atomics and may be called from any thread.
+    class LatencyHistogram {
+    public:
+        static constexpr size_t BUCKETS = 240;
+
+        LatencyHistogram();
+
+        LatencyHistogram(LatencyHistogram const&) = delete;
+        void operator=(LatencyHistogram const&) = delete;
+
+        void record(std::chrono::microseconds latency);
+
+        LatencySnapshot snapshot() const;
+
+        static size_t bucket_index(uint64_t us);
+
+        static uint64_t bucket_lower_bound(size_t index);
+
+    private:
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> sum_us;
+        std::atomic<uint64_t> max_us;
+        std::atomic<uint64_t> buckets[BUCKETS];
+    };
+
+    struct Metrics {
+        uint64_t rx_bytes;
+        uint64_t rx_read_calls;
+        uint64_t rx_frames;
+        uint64_t tx_bytes;
+        uint64_t tx_write_calls;
+        uint64_t tx_frames;
+        uint64_t tx_dropped_frames;
+        uint64_t crc8_errors;
+        uint64_t crc16_errors;
+        uint64_t resyncs;
+        uint64_t rpc_timeouts;
+        uint64_t serial_errors;
+        uint64_t reconnects;
+        uint64_t tx_queue_depth;
+        uint64_t tx_queue_depth_max;
+        uint64_t console_dropped_bytes;
+        // From noticing a lost connection to having the port open again.
+        LatencySnapshot reconnect_time;
+        // Round trip of completed RPCs keyed by request cmd_id.
+        std::map<uint16_t, LatencySnapshot> rpc_latency;
+    };
+}
+
+#endif //HUMANOID_SDK_METRICS_H
@@ -170,6 +170,14 @@ typedef struct
     uint16_t targets[10];
 } cmd_linear_actuator_broadcast_follows_t;
 
+// SET_MAESTRO_MASKED_CHANNEL
+#define CMD_SET_MAESTRO_MASKED_CHANNEL (0x010au)
+typedef struct
+{
+    uint8_t mask[3];    //bit n of mask[n / 8] selects channel n
+    uint16_t targets[24];    //units: quarter-microseconds, only the selected channels are sent, in ascending order
+} cmd_set_maestro_masked_channel_t;
+
 #pragma pack(pop)
 
 
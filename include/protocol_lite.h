@@ -25,6 +25,7 @@ extern "C"
 #endif
 
 #include <stdint.h>
+#include <stddef.h>
 
 #define PROTOCOL_HEADER                         0xA5
 #define PROTOCOL_FRAME_MAX_SIZE                 128
@@ -74,8 +75,21 @@ typedef struct
     uint8_t         protocol_packet[PROTOCOL_FRAME_MAX_SIZE];
     unpack_step_e   unpack_step;
     uint16_t        index;
+
+    // Decoder error counters, cleared by protocol_initialize_unpack_object().
+    uint32_t        crc8_errors;
+    uint32_t        crc16_errors;
+    // Candidate frames given up (bad length or checksum), decoding restarts at the next header byte.
+    uint32_t        resyncs;
 } unpack_data_t;
 
+/*
+ * Called by protocol_unpack_buffer() for every valid frame.
+ * data points into the caller's buffer, or into unpack_data_t::protocol_packet when the
+ * frame straddled two chunks, and is only valid for the duration of the call.
+ */
+typedef void (*protocol_frame_callback_t)(void *context, uint16_t cmd_id, const uint8_t *data, uint16_t len);
+
 // API
 
 extern uint32_t protocol_calculate_frame_size(uint32_t data_size);
@@ -86,6 +100,19 @@ extern void protocol_initialize_unpack_object(unpack_data_t* unpack_obj);
 
 extern uint32_t protocol_unpack_byte(unpack_data_t* unpack_obj, uint8_t byte);
 
+extern uint32_t protocol_unpack_buffer(unpack_data_t* unpack_obj, const uint8_t *buffer, size_t size,
+                                       protocol_frame_callback_t callback, void *context);
+
+// Checksum
+
+extern uint8_t get_crc8(const uint8_t *pchMessage, uint32_t dwLength);
+
+extern uint16_t get_crc16(const uint8_t *pchMessage, uint32_t dwLength);
+
+extern uint32_t get_crc32(const uint8_t *pchMessage, uint32_t dwLength);
+
+extern const char *get_crc32_implementation(void);
+
 // Utils
 
 extern char get_endianness();
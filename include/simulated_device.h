@@ -0,0 +1,92 @@
+#ifndef HUMANOID_SDK_SIMULATED_DEVICE_H
+#define HUMANOID_SDK_SIMULATED_DEVICE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "transport.h"
+#include "protocol_lite.h"
+#include "protocol_definition.h"
+
+namespace humanoid_sdk {
+
+    struct SimulatedDeviceOptions {
+        // Delay between receiving a request and sending its response.
+        std::chrono::microseconds latency{0};
+        // Extra random delay added to latency, uniformly distributed. Responses keep their order.
+        std::chrono::microseconds jitter{0};
+        // Probability that a received frame is ignored, as if it was lost on the wire.
+        double loss_rate{0.0};
+        uint32_t seed{0};
+    };
+
+    // Firmware model answering the RPCs of protocol_definition.h over an in-process loopback, for
+    // benchmarking and testing the SDK without a robot. Actuators of any id reach their target instantly.
+    class SimulatedDevice {
+    public:
+        explicit SimulatedDevice(const SimulatedDeviceOptions &options = SimulatedDeviceOptions());
+
+        ~SimulatedDevice();
+
+        SimulatedDevice(SimulatedDevice const&) = delete;
+        void operator=(SimulatedDevice const&) = delete;
+
+        // SDK side of the link, pass it to the HumanoidSDK constructor. Can be taken once.
+        std::unique_ptr<Transport> host_transport();
+
+        // Send console output to the host as the firmware shell would.
+        void write_console(const std::string &s);
+
+        uint16_t maestro_target(uint8_t channel);
+
+        uint64_t received_frames() const;
+
+        uint64_t dropped_frames() const;
+
+    private:
+        struct ActuatorState {
+            uint16_t target_position{0};
+            uint16_t current_position{0};
+            uint8_t error_code{0};
+        };
+
+        struct DelayedWrite {
+            std::chrono::steady_clock::time_point due;
+            std::vector<uint8_t> bytes;
+        };
+
+        SimulatedDeviceOptions options;
+        std::unique_ptr<LoopbackTransport> device_end;
+        std::unique_ptr<LoopbackTransport> host_end;
+
+        std::mutex state_mutex;
+        ActuatorState actuators[256];
+        uint16_t maestro_targets[24];
+        std::mt19937 random_engine;
+        // Responses waiting for their due time, in order.
+        std::deque<DelayedWrite> delayed_writes;
+
+        std::atomic<uint64_t> received_frame_count;
+        std::atomic<uint64_t> dropped_frame_count;
+
+        std::atomic<bool> running;
+        std::thread device_thread;
+
+        void device_thread_function();
+
+        void handle_frame(uint16_t cmd_id, const uint8_t *p_data, uint16_t len);
+
+        void respond(uint16_t cmd_id, const void *p_data, uint16_t len);
+
+        void respond_linear_actuator(uint8_t id);
+    };
+}
+
+#endif //HUMANOID_SDK_SIMULATED_DEVICE_H
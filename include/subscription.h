@@ -0,0 +1,221 @@
+#ifndef HUMANOID_SDK_SUBSCRIPTION_H
+#define HUMANOID_SDK_SUBSCRIPTION_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include "protocol_lite.h"
+
+namespace humanoid_sdk {
+
+    // What a subscription does with a new element while its queue is full.
+    enum class OverflowPolicy {
+        // Overwrite the oldest unread element, the RX thread never waits.
+        DROP_OLDEST,
+        // Discard the new element.
+        DROP_NEWEST,
+        // The RX thread waits for the consumer, which stalls every other frame until it catches up. The wait is
+        // bounded by BLOCK_TIMEOUT, after which the element is dropped. A consumer must not subscribe or unsubscribe
+        // while its BLOCK queue may be full: that waits for the RX thread, which waits for the consumer.
+        BLOCK
+    };
+
+    // Longest a BLOCK producer waits for room before dropping the element.
+    constexpr std::chrono::milliseconds BLOCK_TIMEOUT(100);
+
+    // A received frame, only the first len bytes of data are valid.
+    struct ReceivedFrame {
+        std::chrono::steady_clock::time_point timestamp;
+        uint16_t cmd_id;
+        uint16_t len;
+        uint8_t data[PROTOCOL_DATA_MAX_SIZE];
+    };
+
+    // Bounded queue between the SDK RX thread (single producer) and one consumer thread that drains it in batches.
+    // Elements are copied through atomic words with a sequence per slot (seqlock), so with DROP_OLDEST the producer
+    // may overwrite the slot being read: the consumer notices and skips ahead instead of returning a torn element.
+    template<typename T>
+    class SubscriptionQueue {
+        static_assert(std::is_trivially_copyable<T>::value, "elements are copied as raw words");
+
+    public:
+        // capacity is rounded up to a power of two.
+        SubscriptionQueue(size_t capacity, OverflowPolicy policy)
+                : policy(policy), head(0), tail(0), dropped_count(0), is_closed(false),
+                  producer_waiting(false), consumer_waiting(false) {
+            size_t size = 1;
+            while (size < capacity) {
+                size <<= 1;
+            }
+            slots.reset(new Slot[size]);
+            mask = size - 1;
+            for (size_t i = 0; i < size; ++i) {
+                // Never equal to the sequence of a written position.
+                slots[i].sequence.store(0, std::memory_order_relaxed);
+            }
+        }
+
+        SubscriptionQueue(SubscriptionQueue const&) = delete;
+        void operator=(SubscriptionQueue const&) = delete;
+
+        // Producer only. Returns false if the element was dropped.
+        bool push(const T &element) {
+            if (is_closed.load(std::memory_order_acquire)) {
+                return false;
+            }
+            uint64_t pos = head.load(std::memory_order_relaxed);
+            if (policy != OverflowPolicy::DROP_OLDEST && pos - tail.load(std::memory_order_acquire) > mask) {
+                if (policy == OverflowPolicy::DROP_NEWEST) {
+                    dropped_count.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                std::unique_lock<std::mutex> lock(mutex);
+                producer_waiting.store(true);
+                bool has_room = producer_condition_variable.wait_for(lock, BLOCK_TIMEOUT, [this, pos]() {
+                    return pos - tail.load() <= mask || is_closed.load();
+                });
+                producer_waiting.store(false, std::memory_order_relaxed);
+                if (is_closed.load(std::memory_order_relaxed)) {
+                    return false;
+                }
+                if (!has_room) {
+                    dropped_count.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+            }
+
+            uint64_t words[WORDS] = {};
+            memcpy(words, &element, sizeof(T));
+
+            Slot &slot = slots[pos & mask];
+            slot.sequence.store(2 * pos + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            for (size_t i = 0; i < WORDS; ++i) {
+                slot.payload[i].store(words[i], std::memory_order_relaxed);
+            }
+            slot.sequence.store(2 * pos + 2, std::memory_order_release);
+
+            head.store(pos + 1);
+            if (consumer_waiting.load()) {
+                std::lock_guard<std::mutex> lock(mutex);
+                consumer_condition_variable.notify_one();
+            }
+            return true;
+        }
+
+        // Consumer only: move up to max_count elements into out, oldest first. Never blocks.
+        size_t pop(T *out, size_t max_count) {
+            uint64_t t = tail.load(std::memory_order_relaxed);
+            size_t n = 0;
+            while (n < max_count) {
+                uint64_t h = head.load(std::memory_order_acquire);
+                if (h - t > mask + 1) {
+                    // Overrun with DROP_OLDEST, continue with the oldest element still in the queue.
+                    dropped_count.fetch_add(h - t - (mask + 1), std::memory_order_relaxed);
+                    t = h - (mask + 1);
+                }
+                if (t == h) {
+                    break;
+                }
+
+                const Slot &slot = slots[t & mask];
+                uint64_t words[WORDS];
+                uint64_t begin = slot.sequence.load(std::memory_order_acquire);
+                for (size_t i = 0; i < WORDS; ++i) {
+                    words[i] = slot.payload[i].load(std::memory_order_relaxed);
+                }
+                std::atomic_thread_fence(std::memory_order_acquire);
+                uint64_t end = slot.sequence.load(std::memory_order_relaxed);
+                if (begin != 2 * t + 2 || end != begin) {
+                    // Overwritten meanwhile, the producer is about to publish a head past t.
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                memcpy(&out[n], words, sizeof(T));
+                ++n;
+                ++t;
+            }
+
+            tail.store(t);
+            if (n > 0 && producer_waiting.load()) {
+                std::lock_guard<std::mutex> lock(mutex);
+                producer_condition_variable.notify_one();
+            }
+            return n;
+        }
+
+        // Consumer only: like pop(), but wait up to timeout for the first element. Returns 0 on timeout or close.
+        size_t wait_pop(T *out, size_t max_count, const std::chrono::milliseconds &timeout) {
+            size_t n = pop(out, max_count);
+            if (n > 0 || timeout.count() <= 0) {
+                return n;
+            }
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                consumer_waiting.store(true);
+                consumer_condition_variable.wait_for(lock, timeout, [this]() {
+                    return head.load() != tail.load(std::memory_order_relaxed) || is_closed.load();
+                });
+                consumer_waiting.store(false, std::memory_order_relaxed);
+            }
+            return pop(out, max_count);
+        }
+
+        // Elements lost to overflow so far, including those DROP_OLDEST overwrote and the consumer has not skipped yet.
+        uint64_t dropped() const {
+            uint64_t h = head.load(std::memory_order_acquire);
+            uint64_t t = tail.load(std::memory_order_acquire);
+            uint64_t overrun = h - t > mask + 1 ? h - t - (mask + 1) : 0;
+            return dropped_count.load(std::memory_order_relaxed) + overrun;
+        }
+
+        // Wake a waiting producer or consumer, every later push is dropped. Unread elements can still be popped.
+        void close() {
+            is_closed.store(true);
+            std::lock_guard<std::mutex> lock(mutex);
+            producer_condition_variable.notify_all();
+            consumer_condition_variable.notify_all();
+        }
+
+        bool closed() const {
+            return is_closed.load(std::memory_order_acquire);
+        }
+
+    private:
+        static constexpr size_t WORDS = (sizeof(T) + 7) / 8;
+
+        struct Slot {
+            // 2 * position + 1 while written, 2 * position + 2 once the element at position is complete.
+            std::atomic<uint64_t> sequence;
+            std::atomic<uint64_t> payload[WORDS];
+        };
+
+        const OverflowPolicy policy;
+        std::unique_ptr<Slot[]> slots;
+        uint64_t mask;
+        // Keep producer and consumer positions on separate cache lines.
+        char padding0[64];
+        std::atomic<uint64_t> head;
+        char padding1[64];
+        std::atomic<uint64_t> tail;
+        char padding2[64];
+        std::atomic<uint64_t> dropped_count;
+        std::atomic<bool> is_closed;
+
+        // Only used to sleep with the BLOCK policy or in wait_pop(), the flags tell the other side to notify.
+        std::atomic<bool> producer_waiting;
+        std::atomic<bool> consumer_waiting;
+        std::mutex mutex;
+        std::condition_variable producer_condition_variable;
+        std::condition_variable consumer_condition_variable;
+    };
+}
+
+#endif //HUMANOID_SDK_SUBSCRIPTION_H
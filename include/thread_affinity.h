@@ -0,0 +1,13 @@
+#ifndef HUMANOID_SDK_THREAD_AFFINITY_H
+#define HUMANOID_SDK_THREAD_AFFINITY_H
+
+namespace humanoid_sdk {
+
+    // Pin the calling thread to one CPU. Prints the reason to stderr and returns false on failure. Linux only.
+    bool pin_current_thread(int cpu, const char *thread_name);
+
+    // Switch the calling thread to SCHED_FIFO with this priority (1-99). Same error reporting. Linux only.
+    bool set_current_thread_realtime_priority(int priority, const char *thread_name);
+}
+
+#endif //HUMANOID_SDK_THREAD_AFFINITY_H
@@ -5,33 +5,78 @@
 #include <atomic>
 #include <chrono>
 #include <functional>
+#include <memory>
 #include <mutex>
+#include <condition_variable>
 #include <vector>
 
 class TimerManagement {
 public:
+    using Clock = std::chrono::steady_clock;
+
+    // Identifies a timer, see cancel_timer().
+    using TimerHandle = uint64_t;
+
+    enum class TimerMode {
+        // Deadlines advance by the interval from the previous deadline, missed periods are skipped.
+        FIXED_RATE,
+        // The next deadline is one interval after the callback returns.
+        FIXED_DELAY
+    };
+
     TimerManagement();
 
     ~TimerManagement();
 
-    void add_timer(const std::function<void(void)>& function, const std::chrono::milliseconds& interval);
+    TimerManagement(TimerManagement const&) = delete;
+    void operator=(TimerManagement const&) = delete;
+
+    // Callbacks run on the timer thread without any lock held, the first run is one interval from now.
+    TimerHandle add_timer(const std::function<void(void)>& function, const std::chrono::milliseconds& interval,
+                          TimerMode mode = TimerMode::FIXED_RATE);
+
+    // Stop a timer, a callback already running is not interrupted. Returns false for an unknown handle.
+    bool cancel_timer(TimerHandle handle);
+
+    // Stop the timer thread and wait for a running callback to return, no callback runs afterwards.
+    // Must not be called from a timer callback.
+    void stop();
 
 private:
 
     struct ManagedTimer {
-        ManagedTimer(std::function<void(void)> _function, const std::chrono::milliseconds& _interval);
+        ManagedTimer(TimerHandle _handle, std::function<void(void)> _function,
+                     const std::chrono::milliseconds& _interval, TimerMode _mode);
+        TimerHandle handle;
         std::function<void(void)> function;
-        std::chrono::time_point<std::chrono::high_resolution_clock> last_time;
-        std::chrono::milliseconds interval;
+        Clock::duration interval;
+        TimerMode mode;
+        bool cancelled{false};
+    };
+
+    struct ScheduledTimer {
+        Clock::time_point deadline;
+        std::shared_ptr<ManagedTimer> timer;
+
+        // Inverted so the std heap functions keep the earliest deadline on top.
+        bool operator<(const ScheduledTimer &other) const {
+            return deadline > other.deadline;
+        }
     };
 
     std::mutex timers_mutex;
-    std::vector<ManagedTimer> timers;
+    std::condition_variable timers_condition_variable;
+    // Min-heap on deadline, a timer being run is absent until it is rescheduled.
+    std::vector<ScheduledTimer> timers;
+    std::shared_ptr<ManagedTimer> running_timer;
+    TimerHandle last_handle;
 
-    std::atomic<bool> running;
+    bool running;
     std::thread timer_thread;
     void timer_thread_function();
 
+    void schedule(Clock::time_point deadline, std::shared_ptr<ManagedTimer> timer);
+
 };
 
 #endif //HUMANOID_SDK_TIMER_H
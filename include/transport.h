@@ -0,0 +1,159 @@
+#ifndef HUMANOID_SDK_TRANSPORT_H
+#define HUMANOID_SDK_TRANSPORT_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "serial/serial.h"
+#include "hotplug_monitor.h"
+
+namespace humanoid_sdk {
+
+    // Byte stream between the SDK and a board. I/O errors are reported with serial::IOException,
+    // after which the SDK closes the transport and opens it again.
+    class Transport {
+    public:
+        virtual ~Transport() = default;
+
+        // Look for the device and open it, returns false if there is nothing to open yet.
+        virtual bool open() = 0;
+
+        virtual void close() = 0;
+
+        virtual bool is_open() = 0;
+
+        // Human readable name of the device, for log messages.
+        virtual std::string name() = 0;
+
+        // Block for a short while until data is available, returns false on timeout.
+        virtual bool wait_readable() = 0;
+
+        virtual size_t available() = 0;
+
+        virtual size_t read(uint8_t *buffer, size_t size) = 0;
+
+        virtual size_t write(const uint8_t *data, size_t size) = 0;
+
+        // Called after open() failed, block until the device may have appeared or timeout elapses.
+        virtual void wait_for_device(std::chrono::milliseconds timeout) {
+            std::this_thread::sleep_for(timeout);
+        }
+    };
+
+    struct SerialTransportOptions {
+        // Open this port (e.g. a pty) instead of scanning USB devices by VID/PID.
+        std::string port;
+        // Only accept a USB device with this serial number.
+        std::string serial_number;
+        // Only accept a board answering CMD_READ_UID_REQUEST with this UID, as the 12 raw bytes returned by
+        // HumanoidSDK::read_uid() or their 24 hex digits.
+        std::string uid;
+        uint32_t baudrate{921600};
+    };
+
+    // Serial port of the board. Ports opened by another SerialTransport of this process are skipped, so several
+    // transports with the same filters bind to different boards.
+    class SerialTransport : public Transport {
+    public:
+        static constexpr uint16_t DEFAULT_VID = 0x0483;
+        static constexpr uint16_t DEFAULT_PID = 0x5740;
+
+        explicit SerialTransport(uint32_t baudrate = 921600);
+
+        SerialTransport(const std::string &port, uint32_t baudrate = 921600);
+
+        explicit SerialTransport(const SerialTransportOptions &options);
+
+        ~SerialTransport() override;
+
+        bool open() override;
+
+        void close() override;
+
+        bool is_open() override;
+
+        std::string name() override;
+
+        bool wait_readable() override;
+
+        size_t available() override;
+
+        size_t read(uint8_t *buffer, size_t size) override;
+
+        size_t write(const uint8_t *data, size_t size) override;
+
+        // Returns as soon as a tty node is created or removed, see HotplugMonitor.
+        void wait_for_device(std::chrono::milliseconds timeout) override;
+
+    private:
+        SerialTransportOptions options;
+        serial::Serial serial_port;
+        // Port this instance holds in the process wide claim set, guarded by the same mutex as the set.
+        std::string claimed_port;
+        HotplugMonitor hotplug_monitor;
+        // Ports of matching boards. Built by one full enumeration, then kept current from hotplug events.
+        std::vector<std::string> known_ports;
+        bool known_ports_valid{false};
+
+        std::vector<std::string> scan_robots();
+
+        void update_known_ports();
+
+        void configure_port(const std::string &port_name);
+
+        bool probe_uid();
+
+        void release_port();
+    };
+
+    // In-process byte pipe, see LoopbackTransport::create_pair().
+    class LoopbackTransport : public Transport {
+    public:
+        // Two connected ends, bytes written to one are read from the other.
+        static std::pair<std::unique_ptr<LoopbackTransport>, std::unique_ptr<LoopbackTransport>> create_pair();
+
+        bool open() override;
+
+        void close() override;
+
+        bool is_open() override;
+
+        std::string name() override;
+
+        bool wait_readable() override;
+
+        // Returns false if no data arrived within timeout.
+        bool wait_readable(std::chrono::microseconds timeout);
+
+        size_t available() override;
+
+        size_t read(uint8_t *buffer, size_t size) override;
+
+        size_t write(const uint8_t *data, size_t size) override;
+
+    private:
+        struct Pipe {
+            std::mutex mutex;
+            std::condition_variable condition_variable;
+            std::deque<uint8_t> bytes;
+        };
+
+        LoopbackTransport(std::string name, std::shared_ptr<Pipe> rx_pipe, std::shared_ptr<Pipe> tx_pipe);
+
+        std::string loopback_name;
+        std::shared_ptr<Pipe> rx_pipe;
+        std::shared_ptr<Pipe> tx_pipe;
+        std::atomic<bool> opened;
+    };
+}
+
+#endif //HUMANOID_SDK_TRANSPORT_H
@@ -0,0 +1,312 @@
+#include "capture.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace humanoid_sdk;
+
+static const char CAPTURE_MAGIC[8] = {'H', 'S', 'D', 'K', 'C', 'A', 'P', '1'};
+
+constexpr size_t CaptureRecorder::RECORD_HEADER_SIZE;
+
+static void encode_record_header(uint8_t *header, uint64_t timestamp, CaptureDirection direction, uint16_t len) {
+    for (int i = 0; i < 8; ++i) {
+        header[i] = (uint8_t) (timestamp >> (8 * i));
+    }
+    header[8] = (uint8_t) direction;
+    header[9] = (uint8_t) (len & 0xff);
+    header[10] = (uint8_t) (len >> 8);
+}
+
+static uint64_t decode_timestamp(const uint8_t *header) {
+    uint64_t timestamp = 0;
+    for (int i = 0; i < 8; ++i) {
+        timestamp |= (uint64_t) header[i] << (8 * i);
+    }
+    return timestamp;
+}
+
+CaptureRecorder::CaptureRecorder(size_t _ring_capacity)
+        : ring_capacity(2), enabled(false), dropped(0), start_ticks(0), writer_running(false), file(nullptr) {
+    while (ring_capacity < _ring_capacity) {
+        ring_capacity <<= 1;
+    }
+}
+
+CaptureRecorder::~CaptureRecorder() {
+    stop();
+}
+
+bool CaptureRecorder::start(const std::string &path) {
+    stop();
+
+    file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    std::fwrite(CAPTURE_MAGIC, 1, sizeof(CAPTURE_MAGIC), file);
+
+    for (auto &ring : rings) {
+        // Allocated on first use so an SDK that never captures does not pay for the rings.
+        if (!ring.buffer) {
+            ring.buffer.reset(new uint8_t[ring_capacity]);
+        }
+        ring.tail.store(ring.head.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+    start_ticks = std::chrono::steady_clock::now().time_since_epoch().count();
+    dropped.store(0, std::memory_order_relaxed);
+
+    writer_running = true;
+    writer_thread = std::thread(&CaptureRecorder::writer_thread_function, this);
+    enabled.store(true, std::memory_order_release);
+    return true;
+}
+
+void CaptureRecorder::stop() {
+    enabled.store(false, std::memory_order_relaxed);
+    if (!writer_thread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        writer_running = false;
+        writer_condition_variable.notify_one();
+    }
+    writer_thread.join();
+    std::fclose(file);
+    file = nullptr;
+}
+
+uint64_t CaptureRecorder::dropped_bytes() const {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+void CaptureRecorder::record(CaptureDirection direction, const uint8_t *data, size_t len) {
+    if (!enabled.load(std::memory_order_acquire) || len == 0) {
+        return;
+    }
+
+    Ring &ring = rings[(size_t) direction];
+    size_t head = ring.head.load(std::memory_order_relaxed);
+    size_t tail = ring.tail.load(std::memory_order_acquire);
+    len = std::min<size_t>(len, UINT16_MAX);
+    if (ring_capacity - (head - tail) < RECORD_HEADER_SIZE + len) {
+        dropped.fetch_add(len, std::memory_order_relaxed);
+        return;
+    }
+
+    uint8_t header[RECORD_HEADER_SIZE];
+    encode_record_header(header, (uint64_t) std::chrono::steady_clock::now().time_since_epoch().count(), direction,
+                         (uint16_t) len);
+
+    const uint8_t *parts[2] = {header, data};
+    size_t part_sizes[2] = {RECORD_HEADER_SIZE, len};
+    for (int i = 0; i < 2; ++i) {
+        size_t offset = head & (ring_capacity - 1);
+        size_t first = std::min(part_sizes[i], ring_capacity - offset);
+        memcpy(ring.buffer.get() + offset, parts[i], first);
+        memcpy(ring.buffer.get(), parts[i] + first, part_sizes[i] - first);
+        head += part_sizes[i];
+    }
+    ring.head.store(head, std::memory_order_release);
+}
+
+void CaptureRecorder::ring_read(Ring &ring, size_t pos, uint8_t *out, size_t len) {
+    size_t offset = pos & (ring_capacity - 1);
+    size_t first = std::min(len, ring_capacity - offset);
+    memcpy(out, ring.buffer.get() + offset, first);
+    memcpy(out + first, ring.buffer.get(), len - first);
+}
+
+bool CaptureRecorder::drain() {
+    uint8_t headers[2][RECORD_HEADER_SIZE];
+    size_t heads[2];
+    for (int i = 0; i < 2; ++i) {
+        heads[i] = rings[i].head.load(std::memory_order_acquire);
+    }
+
+    bool written = false;
+    uint8_t data[UINT16_MAX];
+    for (;;) {
+        // Merge the two rings by timestamp.
+        int next = -1;
+        for (int i = 0; i < 2; ++i) {
+            size_t tail = rings[i].tail.load(std::memory_order_relaxed);
+            if (tail == heads[i]) {
+                continue;
+            }
+            ring_read(rings[i], tail, headers[i], RECORD_HEADER_SIZE);
+            if (next < 0 || decode_timestamp(headers[i]) < decode_timestamp(headers[next])) {
+                next = i;
+            }
+        }
+        if (next < 0) {
+            return written;
+        }
+
+        Ring &ring = rings[next];
+        size_t tail = ring.tail.load(std::memory_order_relaxed);
+        size_t len = headers[next][9] | (headers[next][10] << 8);
+        ring_read(ring, tail + RECORD_HEADER_SIZE, data, len);
+        ring.tail.store(tail + RECORD_HEADER_SIZE + len, std::memory_order_release);
+
+        // Records from before start() were written by a producer that had not seen stop() yet.
+        auto ticks = (int64_t) decode_timestamp(headers[next]);
+        if (ticks < start_ticks) {
+            continue;
+        }
+        auto timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::duration(ticks - start_ticks)).count();
+        encode_record_header(headers[next], (uint64_t) timestamp, (CaptureDirection) headers[next][8], (uint16_t) len);
+        std::fwrite(headers[next], 1, RECORD_HEADER_SIZE, file);
+        std::fwrite(data, 1, len, file);
+        written = true;
+    }
+}
+
+void CaptureRecorder::writer_thread_function() {
+    std::unique_lock<std::mutex> lock(writer_mutex);
+    while (writer_running) {
+        writer_condition_variable.wait_for(lock, std::chrono::milliseconds(10));
+        lock.unlock();
+        if (drain()) {
+            std::fflush(file);
+        }
+        lock.lock();
+    }
+    lock.unlock();
+    drain();
+}
+
+CaptureReader::CaptureReader() : file(nullptr) {
+
+}
+
+CaptureReader::~CaptureReader() {
+    if (file != nullptr) {
+        std::fclose(file);
+    }
+}
+
+bool CaptureReader::open(const std::string &path) {
+    if (file != nullptr) {
+        std::fclose(file);
+    }
+    file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    char magic[sizeof(CAPTURE_MAGIC)];
+    if (std::fread(magic, 1, sizeof(magic), file) != sizeof(magic) || memcmp(magic, CAPTURE_MAGIC, sizeof(magic)) != 0) {
+        std::fclose(file);
+        file = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool CaptureReader::next(CaptureRecord &record) {
+    uint8_t header[11];
+    if (file == nullptr || std::fread(header, 1, sizeof(header), file) != sizeof(header)) {
+        return false;
+    }
+    size_t len = header[9] | (header[10] << 8);
+    record.timestamp = std::chrono::nanoseconds(decode_timestamp(header));
+    record.direction = (CaptureDirection) header[8];
+    record.data.resize(len);
+    return std::fread(record.data.data(), 1, len, file) == len;
+}
+
+ReplayTransport::ReplayTransport(const std::string &_path, bool _original_speed)
+        : path(_path), original_speed(_original_speed), opened(false), next_record(0), next_offset(0) {
+
+}
+
+bool ReplayTransport::open() {
+    std::lock_guard<std::mutex> lock(mutex);
+    CaptureReader reader;
+    if (!reader.open(path)) {
+        return false;
+    }
+    records.clear();
+    CaptureRecord record;
+    while (reader.next(record)) {
+        if (record.direction == CaptureDirection::RX) {
+            records.push_back(std::move(record));
+        }
+    }
+    next_record = 0;
+    next_offset = 0;
+    replay_start = std::chrono::steady_clock::now();
+    opened = true;
+    return true;
+}
+
+void ReplayTransport::close() {
+    opened = false;
+}
+
+bool ReplayTransport::is_open() {
+    return opened;
+}
+
+std::string ReplayTransport::name() {
+    return path;
+}
+
+bool ReplayTransport::finished() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return opened && next_record == records.size();
+}
+
+bool ReplayTransport::record_due() {
+    if (next_record == records.size()) {
+        return false;
+    }
+    return !original_speed ||
+           std::chrono::steady_clock::now() - replay_start >= records[next_record].timestamp;
+}
+
+bool ReplayTransport::wait_readable() {
+    std::chrono::steady_clock::time_point wake = std::chrono::steady_clock::now() + std::chrono::milliseconds(200);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (record_due()) {
+            return true;
+        }
+        if (next_record < records.size()) {
+            auto due = replay_start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    records[next_record].timestamp);
+            wake = std::min(wake, due);
+        }
+    }
+    std::this_thread::sleep_until(wake);
+    std::lock_guard<std::mutex> lock(mutex);
+    return record_due();
+}
+
+size_t ReplayTransport::available() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return record_due() ? records[next_record].data.size() - next_offset : 0;
+}
+
+size_t ReplayTransport::read(uint8_t *buffer, size_t size) {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t copied = 0;
+    while (copied < size && record_due()) {
+        const std::vector<uint8_t> &data = records[next_record].data;
+        size_t n = std::min(size - copied, data.size() - next_offset);
+        memcpy(buffer + copied, data.data() + next_offset, n);
+        copied += n;
+        next_offset += n;
+        if (next_offset == data.size()) {
+            next_record++;
+            next_offset = 0;
+        }
+    }
+    return copied;
+}
+
+size_t ReplayTransport::write(const uint8_t *data, size_t size) {
+    (void) data;
+    return size;
+}
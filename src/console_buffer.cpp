@@ -0,0 +1,91 @@
+#include "console_buffer.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace humanoid_sdk;
+
+ConsoleBuffer::ConsoleBuffer(size_t capacity) : head(0), tail(0), dropped(0) {
+    size_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    buffer.reset(new char[size]);
+    mask = size - 1;
+}
+
+void ConsoleBuffer::write(const uint8_t *data, size_t len) {
+    size_t h = head.load(std::memory_order_relaxed);
+    size_t free_space = mask + 1 - (h - tail.load(std::memory_order_acquire));
+    size_t n = std::min(len, free_space);
+    if (n < len) {
+        dropped.fetch_add(len - n, std::memory_order_relaxed);
+    }
+    if (n == 0) {
+        return;
+    }
+
+    size_t offset = h & mask;
+    size_t first = std::min(n, mask + 1 - offset);
+    memcpy(&buffer[offset], data, first);
+    memcpy(&buffer[0], data + first, n - first);
+    head.store(h + n, std::memory_order_release);
+}
+
+size_t ConsoleBuffer::read(std::string &s) {
+    std::lock_guard<std::mutex> lock(reader_mutex);
+    size_t t = tail.load(std::memory_order_relaxed);
+    size_t len = head.load(std::memory_order_acquire) - t;
+    s.clear();
+    copy_out(t, len, s);
+    tail.store(t + len, std::memory_order_release);
+    return len;
+}
+
+bool ConsoleBuffer::read_line(std::string &line) {
+    std::lock_guard<std::mutex> lock(reader_mutex);
+    size_t t = tail.load(std::memory_order_relaxed);
+    size_t len = head.load(std::memory_order_acquire) - t;
+
+    // Search the at most two contiguous parts of the ring for the first line break.
+    size_t offset = t & mask;
+    size_t first = std::min(len, mask + 1 - offset);
+    size_t line_len = len;
+    const char *p = (const char *) memchr(&buffer[offset], '\n', first);
+    if (p != nullptr) {
+        line_len = p - &buffer[offset];
+    } else if ((p = (const char *) memchr(&buffer[0], '\n', len - first)) != nullptr) {
+        line_len = first + (p - &buffer[0]);
+    }
+
+    size_t consumed;
+    if (line_len < len) {
+        consumed = line_len + 1;
+    } else if (len == mask + 1) {
+        consumed = len;
+    } else {
+        return false;
+    }
+
+    line.clear();
+    copy_out(t, line_len, line);
+    if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+    }
+    tail.store(t + consumed, std::memory_order_release);
+    return true;
+}
+
+size_t ConsoleBuffer::size() const {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+}
+
+uint64_t ConsoleBuffer::dropped_bytes() const {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+void ConsoleBuffer::copy_out(size_t pos, size_t len, std::string &out) const {
+    size_t offset = pos & mask;
+    size_t first = std::min(len, mask + 1 - offset);
+    out.append(&buffer[offset], first);
+    out.append(&buffer[0], len - first);
+}
@@ -0,0 +1,143 @@
+#include "control_loop.h"
+#include <algorithm>
+#include "thread_affinity.h"
+
+#if defined(__linux__)
+#include <time.h>
+#include <cerrno>
+#endif
+
+using namespace humanoid_sdk;
+
+using Clock = std::chrono::steady_clock;
+
+static void sleep_until_deadline(Clock::time_point deadline) {
+#if defined(__linux__)
+    // steady_clock is CLOCK_MONOTONIC on Linux, an absolute sleep is not extended by signal restarts.
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+    struct timespec ts;
+    ts.tv_sec = (time_t) (ns / 1000000000);
+    ts.tv_nsec = (long) (ns % 1000000000);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+    }
+#else
+    std::this_thread::sleep_until(deadline);
+#endif
+}
+
+static void update_max(std::atomic<int64_t> &max, int64_t value) {
+    int64_t current = max.load(std::memory_order_relaxed);
+    while (value > current && !max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+ControlLoop::ControlLoop(std::function<void(void)> _step, const ControlLoopOptions &_options)
+        : step(std::move(_step)), options(_options), running(false) {
+    if (options.period <= std::chrono::nanoseconds::zero()) {
+        options.period = std::chrono::nanoseconds(1);
+    }
+    reset_statistics();
+}
+
+ControlLoop::~ControlLoop() {
+    stop();
+}
+
+bool ControlLoop::start() {
+    if (running.exchange(true)) {
+        return false;
+    }
+    if (loop_thread.joinable()) {
+        loop_thread.join();
+    }
+    loop_thread = std::thread(&ControlLoop::loop_thread_function, this);
+    return true;
+}
+
+void ControlLoop::stop() {
+    running = false;
+    if (loop_thread.joinable()) {
+        loop_thread.join();
+    }
+}
+
+bool ControlLoop::is_running() const {
+    return running;
+}
+
+ControlLoopStatistics ControlLoop::get_statistics() const {
+    ControlLoopStatistics statistics;
+    statistics.iterations = iterations.load(std::memory_order_relaxed);
+    statistics.overruns = overruns.load(std::memory_order_relaxed);
+    statistics.skipped_periods = skipped_periods.load(std::memory_order_relaxed);
+    statistics.max_wakeup_latency = std::chrono::nanoseconds(max_wakeup_latency_ns.load(std::memory_order_relaxed));
+    statistics.mean_wakeup_latency = std::chrono::nanoseconds(
+            statistics.iterations == 0 ? 0 : total_wakeup_latency_ns.load(std::memory_order_relaxed) /
+                                             (int64_t) statistics.iterations);
+    statistics.max_step_duration = std::chrono::nanoseconds(max_step_duration_ns.load(std::memory_order_relaxed));
+    statistics.wakeup_latency_histogram.resize(ControlLoopStatistics::HISTOGRAM_BUCKETS);
+    for (size_t i = 0; i < ControlLoopStatistics::HISTOGRAM_BUCKETS; ++i) {
+        statistics.wakeup_latency_histogram[i] = wakeup_latency_histogram[i].load(std::memory_order_relaxed);
+    }
+    return statistics;
+}
+
+void ControlLoop::reset_statistics() {
+    iterations.store(0, std::memory_order_relaxed);
+    overruns.store(0, std::memory_order_relaxed);
+    skipped_periods.store(0, std::memory_order_relaxed);
+    max_wakeup_latency_ns.store(0, std::memory_order_relaxed);
+    total_wakeup_latency_ns.store(0, std::memory_order_relaxed);
+    max_step_duration_ns.store(0, std::memory_order_relaxed);
+    for (auto &bucket : wakeup_latency_histogram) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+void ControlLoop::configure_thread() {
+    if (options.cpu >= 0) {
+        pin_current_thread(options.cpu, "control loop");
+    }
+    if (options.realtime_priority > 0) {
+        set_current_thread_realtime_priority(options.realtime_priority, "control loop");
+    }
+}
+
+void ControlLoop::record_wakeup(int64_t latency_ns) {
+    latency_ns = std::max<int64_t>(latency_ns, 0);
+    total_wakeup_latency_ns.fetch_add(latency_ns, std::memory_order_relaxed);
+    update_max(max_wakeup_latency_ns, latency_ns);
+
+    size_t bucket = 0;
+    for (int64_t us = latency_ns / 1000; us > 0 && bucket < ControlLoopStatistics::HISTOGRAM_BUCKETS - 1; us >>= 1) {
+        bucket++;
+    }
+    wakeup_latency_histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+void ControlLoop::loop_thread_function() {
+    configure_thread();
+
+    Clock::time_point deadline = Clock::now() + options.period;
+    while (running) {
+        sleep_until_deadline(deadline);
+        Clock::time_point wakeup = Clock::now();
+        record_wakeup(std::chrono::duration_cast<std::chrono::nanoseconds>(wakeup - deadline).count());
+
+        step();
+
+        Clock::time_point finished = Clock::now();
+        update_max(max_step_duration_ns,
+                   std::chrono::duration_cast<std::chrono::nanoseconds>(finished - wakeup).count());
+        iterations.fetch_add(1, std::memory_order_relaxed);
+
+        deadline += options.period;
+        if (deadline <= finished) {
+            // Overrun: resume on the period grid instead of running the missed steps back to back.
+            uint64_t missed = (uint64_t) ((finished - deadline) / options.period) + 1;
+            deadline += missed * options.period;
+            overruns.fetch_add(1, std::memory_order_relaxed);
+            skipped_periods.fetch_add(missed, std::memory_order_relaxed);
+        }
+    }
+}
@@ -0,0 +1,115 @@
+#include "dispatch_table.h"
+#include <thread>
+
+using namespace humanoid_sdk;
+
+// Dispatch nesting depth of the current thread, a handler may (un)register handlers itself.
+static thread_local int dispatch_depth = 0;
+
+DispatchTable::DispatchTable() : epoch(0) {
+    active_dispatches[0].store(0, std::memory_order_relaxed);
+    active_dispatches[1].store(0, std::memory_order_relaxed);
+    for (auto &group : groups) {
+        group.store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+DispatchTable::~DispatchTable() {
+    for (auto &group : groups) {
+        Group *p_group = group.load(std::memory_order_relaxed);
+        if (p_group != nullptr) {
+            for (auto &handler : p_group->handlers) {
+                delete handler.load(std::memory_order_relaxed);
+            }
+            delete p_group;
+        }
+    }
+    for (FrameCallback *handler : retired_handlers) {
+        delete handler;
+    }
+}
+
+void DispatchTable::set(uint16_t cmd_id, FrameCallback callback) {
+    replace(cmd_id, new FrameCallback(std::move(callback)));
+}
+
+void DispatchTable::remove(uint16_t cmd_id) {
+    replace(cmd_id, nullptr);
+}
+
+bool DispatchTable::dispatch(uint16_t cmd_id, const uint8_t *data, uint16_t len) {
+    struct ActiveGuard {
+        explicit ActiveGuard(std::atomic<uint32_t> &_counter) : counter(_counter) {
+            counter.fetch_add(1, std::memory_order_seq_cst);
+            dispatch_depth++;
+        }
+        ~ActiveGuard() {
+            dispatch_depth--;
+            counter.fetch_sub(1, std::memory_order_release);
+        }
+        std::atomic<uint32_t> &counter;
+    } guard(active_dispatches[epoch.load(std::memory_order_seq_cst) & 1]);
+
+    // seq_cst loads pair with the exchange in replace(): a handler seen here is not freed until we return.
+    Group *group = groups[cmd_id >> 8].load(std::memory_order_seq_cst);
+    if (group == nullptr) {
+        return false;
+    }
+    FrameCallback *handler = group->handlers[cmd_id & 0xff].load(std::memory_order_seq_cst);
+    if (handler == nullptr) {
+        return false;
+    }
+
+    (*handler)(data, len);
+    return true;
+}
+
+void DispatchTable::replace(uint16_t cmd_id, FrameCallback *handler) {
+    std::vector<FrameCallback *> to_free;
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+
+        Group *group = groups[cmd_id >> 8].load(std::memory_order_relaxed);
+        if (group == nullptr) {
+            if (handler == nullptr) {
+                return;
+            }
+            group = new Group;
+            for (auto &p : group->handlers) {
+                p.store(nullptr, std::memory_order_relaxed);
+            }
+            groups[cmd_id >> 8].store(group, std::memory_order_seq_cst);
+        }
+
+        FrameCallback *old_handler = group->handlers[cmd_id & 0xff].exchange(handler, std::memory_order_seq_cst);
+        if (old_handler != nullptr) {
+            retired_handlers.push_back(old_handler);
+        }
+
+        // Called from a handler, possibly the old one: waiting would deadlock, the next writer frees it.
+        if (dispatch_depth > 0 || retired_handlers.empty()) {
+            return;
+        }
+        to_free.swap(retired_handlers);
+    }
+
+    // Wait without writer_mutex, a running handler may be registering handlers itself.
+    wait_for_dispatches();
+    for (FrameCallback *retired : to_free) {
+        delete retired;
+    }
+}
+
+void DispatchTable::wait_for_dispatches() {
+    std::lock_guard<std::mutex> lock(grace_mutex);
+
+    // Grace period: every dispatch that might hold a swapped-out handler was counted in one of the two
+    // counters before the swap. Flipping the epoch sends new dispatches to the other counter, so each
+    // counter drains within one handler call even under continuous traffic.
+    for (int i = 0; i < 2; ++i) {
+        uint32_t drained = epoch.fetch_add(1, std::memory_order_seq_cst) & 1;
+        while (active_dispatches[drained].load(std::memory_order_seq_cst) != 0) {
+            std::this_thread::yield();
+        }
+    }
+}
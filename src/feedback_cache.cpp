@@ -0,0 +1,57 @@
+#include "feedback_cache.h"
+#include <cstring>
+
+using namespace humanoid_sdk;
+
+FeedbackCache::FeedbackCache() {
+    for (auto &entry : entries) {
+        entry.sequence.store(0, std::memory_order_relaxed);
+        entry.timestamp.store(0, std::memory_order_relaxed);
+        for (auto &word : entry.payload) {
+            word.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+void FeedbackCache::update(const cmd_linear_actuator_feedback_t &feedback,
+                           std::chrono::steady_clock::time_point timestamp) {
+    uint64_t words[PAYLOAD_WORDS] = {};
+    memcpy(words, &feedback, sizeof(feedback));
+
+    Entry &entry = entries[feedback.id];
+    uint32_t sequence = entry.sequence.load(std::memory_order_relaxed);
+    entry.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    entry.timestamp.store(timestamp.time_since_epoch().count(), std::memory_order_relaxed);
+    for (size_t i = 0; i < PAYLOAD_WORDS; ++i) {
+        entry.payload[i].store(words[i], std::memory_order_relaxed);
+    }
+
+    entry.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool FeedbackCache::read(uint8_t id, cmd_linear_actuator_feedback_t &feedback,
+                         std::chrono::steady_clock::time_point &timestamp) const {
+    const Entry &entry = entries[id];
+    uint64_t words[PAYLOAD_WORDS];
+    int64_t ticks;
+    uint32_t begin, end;
+
+    do {
+        begin = entry.sequence.load(std::memory_order_acquire);
+        if (begin == 0) {
+            return false;
+        }
+        ticks = entry.timestamp.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < PAYLOAD_WORDS; ++i) {
+            words[i] = entry.payload[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        end = entry.sequence.load(std::memory_order_relaxed);
+    } while ((begin & 1) != 0 || begin != end);
+
+    memcpy(&feedback, words, sizeof(feedback));
+    timestamp = std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(ticks));
+    return true;
+}
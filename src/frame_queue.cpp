@@ -0,0 +1,114 @@
+#include "frame_queue.h"
+#include <cstring>
+
+using namespace humanoid_sdk;
+
+FrameQueue::FrameQueue(size_t capacity) : mask(0), enqueue_pos(0), dequeue_pos(0) {
+    size_t size = 2;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    mask = size - 1;
+
+    slots.reset(new Slot[size]);
+    for (size_t i = 0; i < size; ++i) {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool FrameQueue::push(uint16_t cmd_id, const uint8_t *p_data, uint16_t len) {
+    // Bounded MPMC queue by Dmitry Vyukov, each slot's sequence tells producers whether it is free.
+    size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+    Slot *slot;
+    for (;;) {
+        slot = &slots[pos & mask];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t) sequence - (intptr_t) pos;
+        if (diff == 0) {
+            if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    if (len > PROTOCOL_DATA_MAX_SIZE)
+        len = PROTOCOL_DATA_MAX_SIZE;
+    slot->frame_size = (uint16_t) protocol_pack_data_to_buffer(cmd_id, p_data, len, slot->frame);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool FrameQueue::reserve(size_t count, size_t &pos) {
+    if (count == 0 || count > mask + 1) {
+        return false;
+    }
+    pos = enqueue_pos.load(std::memory_order_relaxed);
+    for (;;) {
+        size_t sequence = slots[pos & mask].sequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t) sequence - (intptr_t) pos;
+        if (diff > 0) {
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+            continue;
+        }
+        if (diff < 0) {
+            return false;
+        }
+        // The consumer frees slots in order, so the whole range is free once its last slot is.
+        size_t last = pos + count - 1;
+        if (slots[last & mask].sequence.load(std::memory_order_acquire) != last) {
+            return false;
+        }
+        if (enqueue_pos.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+}
+
+void FrameQueue::pack(size_t pos, uint16_t cmd_id, const uint8_t *p_data, uint16_t len) {
+    Slot *slot = &slots[pos & mask];
+    if (len > PROTOCOL_DATA_MAX_SIZE)
+        len = PROTOCOL_DATA_MAX_SIZE;
+    slot->frame_size = (uint16_t) protocol_pack_data_to_buffer(cmd_id, p_data, len, slot->frame);
+}
+
+void FrameQueue::publish(size_t pos, size_t count) {
+    // Last first: the consumer stops at the first unpublished slot, so it sees none of them before all.
+    for (size_t i = count; i-- > 0;) {
+        slots[(pos + i) & mask].sequence.store(pos + i + 1, std::memory_order_release);
+    }
+}
+
+size_t FrameQueue::pop_frames(uint8_t *buffer, size_t buffer_size) {
+    size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+    size_t bytes = 0;
+    for (;;) {
+        Slot *slot = &slots[pos & mask];
+        if (slot->sequence.load(std::memory_order_acquire) != pos + 1) {
+            break;
+        }
+        if (bytes + slot->frame_size > buffer_size) {
+            break;
+        }
+        memcpy(buffer + bytes, slot->frame, slot->frame_size);
+        bytes += slot->frame_size;
+        slot->sequence.store(pos + mask + 1, std::memory_order_release);
+        ++pos;
+    }
+    dequeue_pos.store(pos, std::memory_order_relaxed);
+    return bytes;
+}
+
+bool FrameQueue::empty() const {
+    size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+    return slots[pos & mask].sequence.load(std::memory_order_acquire) != pos + 1;
+}
+
+size_t FrameQueue::size() const {
+    size_t head = dequeue_pos.load(std::memory_order_relaxed);
+    size_t tail = enqueue_pos.load(std::memory_order_relaxed);
+    return tail > head ? tail - head : 0;
+}
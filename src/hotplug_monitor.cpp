@@ -0,0 +1,105 @@
+#include "hotplug_monitor.h"
+#include <thread>
+#include "fmt/format.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+using namespace humanoid_sdk;
+
+#ifdef __linux__
+
+HotplugMonitor::HotplugMonitor(const std::string &directory) : inotify_fd(-1) {
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0) {
+        fmt::print(stderr, "Cannot watch device hotplug, falling back to polling: {}\n", strerror(errno));
+        return;
+    }
+    // udev creates the node, then sets its owner and mode, the board can only be opened after the latter.
+    if (inotify_add_watch(inotify_fd, directory.c_str(), IN_CREATE | IN_ATTRIB | IN_DELETE | IN_MOVED_TO | IN_MOVED_FROM) < 0) {
+        fmt::print(stderr, "Cannot watch {}, falling back to polling: {}\n", directory, strerror(errno));
+        ::close(inotify_fd);
+        inotify_fd = -1;
+    }
+}
+
+HotplugMonitor::~HotplugMonitor() {
+    if (inotify_fd >= 0) {
+        ::close(inotify_fd);
+    }
+}
+
+bool HotplugMonitor::available() const {
+    return inotify_fd >= 0;
+}
+
+bool HotplugMonitor::wait(std::chrono::milliseconds timeout) {
+    if (inotify_fd < 0) {
+        std::this_thread::sleep_for(timeout);
+        return false;
+    }
+    struct pollfd fds = {inotify_fd, POLLIN, 0};
+    return poll(&fds, 1, (int) timeout.count()) > 0 && (fds.revents & POLLIN) != 0;
+}
+
+std::vector<HotplugEvent> HotplugMonitor::read_events(bool &overflowed) {
+    std::vector<HotplugEvent> events;
+    overflowed = false;
+    if (inotify_fd < 0) {
+        return events;
+    }
+
+    alignas(struct inotify_event) char buffer[4096];
+    for (;;) {
+        ssize_t len = ::read(inotify_fd, buffer, sizeof(buffer));
+        if (len <= 0) {
+            // EAGAIN once everything is consumed.
+            break;
+        }
+        for (char *p = buffer; p < buffer + len; p += sizeof(struct inotify_event) + ((struct inotify_event *) p)->len) {
+            auto *event = (struct inotify_event *) p;
+            if (event->mask & IN_Q_OVERFLOW) {
+                // Carries no name (len is 0), the events after it were discarded by the kernel.
+                overflowed = true;
+                continue;
+            }
+            if (event->len == 0 || strncmp(event->name, "tty", 3) != 0) {
+                continue;
+            }
+            HotplugEvent hotplug_event;
+            hotplug_event.name = event->name;
+            hotplug_event.removed = (event->mask & (IN_DELETE | IN_MOVED_FROM)) != 0;
+            events.push_back(hotplug_event);
+        }
+    }
+    return events;
+}
+
+#else
+
+HotplugMonitor::HotplugMonitor(const std::string &directory) : inotify_fd(-1) {
+    (void) directory;
+}
+
+HotplugMonitor::~HotplugMonitor() = default;
+
+bool HotplugMonitor::available() const {
+    return false;
+}
+
+bool HotplugMonitor::wait(std::chrono::milliseconds timeout) {
+    std::this_thread::sleep_for(timeout);
+    return false;
+}
+
+std::vector<HotplugEvent> HotplugMonitor::read_events(bool &overflowed) {
+    overflowed = false;
+    return std::vector<HotplugEvent>();
+}
+
+#endif
@@ -1,73 +1,152 @@
 #include "humanoid_sdk.h"
+#include <algorithm>
+#include <cstddef>
 
 using namespace humanoid_sdk;
 
-HumanoidSDK::HumanoidSDK() : is_running(true), communication_thread(&HumanoidSDK::communication, this) {
+constexpr size_t HumanoidSDK::MAESTRO_CHANNELS;
+constexpr std::chrono::milliseconds HumanoidSDK::POLLING_RESPONSE_TIMEOUT_MIN;
+constexpr std::chrono::milliseconds HumanoidSDK::POLLING_RESPONSE_TIMEOUT;
+
+static SerialTransportOptions serial_transport_options(const HumanoidSDKOptions &options, uint32_t baudrate) {
+    SerialTransportOptions transport_options;
+    transport_options.port = options.port;
+    transport_options.serial_number = options.serial_number;
+    transport_options.uid = options.uid;
+    transport_options.baudrate = baudrate;
+    return transport_options;
+}
+
+HumanoidSDK::HumanoidSDK(const HumanoidSDKOptions &options)
+        : HumanoidSDK(std::unique_ptr<Transport>(new SerialTransport(serial_transport_options(options, SERIAL_BAUDRATE))),
+                      options) {
+
+}
+
+HumanoidSDK::HumanoidSDK(std::unique_ptr<Transport> _transport, const HumanoidSDKOptions &options)
+        : is_running(true), rx_bytes(0), rx_read_calls(0), tx_bytes(0), tx_write_calls(0),
+          tx_dropped_frames(0), rx_frames(0), tx_frames(0), crc8_errors(0), crc16_errors(0),
+          resyncs(0), rpc_timeouts(0), serial_errors(0), reconnects(0), tx_queue_depth_max(0),
+          transport(std::move(_transport)), rx_cpu(options.rx_cpu), tx_cpu(options.tx_cpu),
+          tx_queue(TX_QUEUE_CAPACITY), tx_writer_sleeping(false), subscription_count(0),
+          console_buffer(CONSOLE_BUFFER_SIZE),
+          last_rpc_handle(0), maestro_sent_targets(), maestro_targets(), maestro_sent_mask(0),
+          maestro_dirty_mask(0), polling_cursor(0), polling_rate(0), polling_budget(0),
+          polling_timer(0), poll_round_trip(0), deferred_rpc_count(0) {
+    for (size_t id = 0; id < 256; ++id) {
+        outstanding_polls[id].store(0, std::memory_order_relaxed);
+        poll_sent_at[id].store(0, std::memory_order_relaxed);
+    }
+
     timer_management.add_timer([this]() {
         send_cmd_with_data(CMD_HEART, nullptr, 0);
     }, std::chrono::milliseconds(500));
 
-    register_cmd_callback(CMD_ECHO_REQUEST, [this](const std::vector<uint8_t> &data) {
-        send_cmd_with_data(CMD_ECHO_RESPONSE, data.data(), data.size());
+    // Fail asynchronous RPCs whose response did not arrive in time.
+    timer_management.add_timer([this]() {
+        auto now = std::chrono::steady_clock::now();
+        expire_polls(now);
+        expire_rpcs(now);
+    }, std::chrono::milliseconds(10), TimerManagement::TimerMode::FIXED_DELAY);
+
+    register_cmd_callback(CMD_ECHO_REQUEST, [this](const uint8_t *p_data, uint16_t len) {
+        send_cmd_with_data(CMD_ECHO_RESPONSE, p_data, len);
     });
 
-    register_cmd_callback(CMD_CONSOLE_OUTPUT, [this](const std::vector<uint8_t> &data) {
-        std::string out_str((const char*)data.data(), data.size());
-        console_output_stream << out_str;
-        // fmt::print("{}", out_str);
+    register_cmd_callback(CMD_READ_UID_RESPONSE, [this](const uint8_t *p_data, uint16_t len) {
+        complete_rpc(CMD_READ_UID_RESPONSE, 0, p_data, len);
     });
-}
 
-std::string HumanoidSDK::scan_robot() {
-    std::vector<serial::PortInfo> devices_found = serial::list_ports();
+    register_cmd_callback(CMD_READ_TEMPERATURE_RESPONSE, [this](const uint8_t *p_data, uint16_t len) {
+        complete_rpc(CMD_READ_TEMPERATURE_RESPONSE, 0, p_data, len);
+    });
 
-    for (const serial::PortInfo &port_info: devices_found) {
-        if (port_info.vid == 0x0483 && port_info.pid == 0x5740) {
-            return port_info.port;
+    // Linear actuator responses are correlated by the actuator id in the first byte of the feedback.
+    register_cmd_callback(CMD_LINEAR_ACTUATOR_RESPONSE, [this](const uint8_t *p_data, uint16_t len) {
+        if (len >= sizeof(cmd_linear_actuator_feedback_t)) {
+            cmd_linear_actuator_feedback_t res;
+            memcpy(&res, p_data, sizeof(res));
+            feedback_cache.update(res, std::chrono::steady_clock::now());
         }
-    }
-
-    return {};
-}
-
-void HumanoidSDK::connect(const std::string &port_name) {
-    auto timeout = serial::Timeout::simpleTimeout(200);
+        if (len > 0 && !consume_poll_response(p_data[0])) {
+            complete_rpc(CMD_LINEAR_ACTUATOR_RESPONSE, p_data[0], p_data, len);
+        }
+    });
 
-    serial_port.setPort(port_name);
-    serial_port.setBaudrate(921600);
-    serial_port.setTimeout(timeout);
-    serial_port.setBytesize(serial::eightbits);
-    serial_port.setParity(serial::parity_none);
-    serial_port.setStopbits(serial::stopbits_one);
-    serial_port.setFlowcontrol(serial::flowcontrol_none);
+    set_console_callback(nullptr);
 
-    serial_port.open();
+    // Start the I/O threads only after every member and handler is in place.
+    transmission_thread = std::thread(&HumanoidSDK::transmission, this);
+    communication_thread = std::thread(&HumanoidSDK::communication, this);
 }
 
 void HumanoidSDK::communication() {
     unpack_data_t unpack_data_obj;
     protocol_initialize_unpack_object(&unpack_data_obj);
+    uint8_t rx_buffer[RX_BUFFER_SIZE];
+    bool connected_before = false;
+    std::chrono::steady_clock::time_point disconnected_at;
+
+    if (rx_cpu >= 0) {
+        pin_current_thread(rx_cpu, "RX thread");
+    }
 
     while (is_running) {
-        if (!serial_port.isOpen()) {
-            auto serial_name = scan_robot();
-            if (!serial_name.empty()) {
-                try {
-                    connect(serial_name);
-                } catch (serial::IOException &e) {
-                    fmt::print(stderr, "Cannot open serial: {}, {}\n", serial_name, e.what());
-                    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (!transport->is_open()) {
+            if (connected_before && disconnected_at == std::chrono::steady_clock::time_point()) {
+                disconnected_at = std::chrono::steady_clock::now();
+            }
+            bool opened = false;
+            try {
+                opened = transport->open();
+            } catch (serial::IOException &e) {
+                serial_errors.fetch_add(1, std::memory_order_relaxed);
+                fmt::print(stderr, "Cannot open serial: {}, {}\n", transport->name(), e.what());
+                // The node may exist before udev grants access to it, which is a device event as well.
+                transport->wait_for_device(std::chrono::milliseconds(100));
+                continue;
+            }
+            if (opened) {
+                if (connected_before) {
+                    reconnects.fetch_add(1, std::memory_order_relaxed);
+                    reconnect_time.record(std::chrono::duration_cast<std::chrono::microseconds>(
+                            std::chrono::steady_clock::now() - disconnected_at));
+                    disconnected_at = std::chrono::steady_clock::time_point();
                 }
+                connected_before = true;
+                // The board may have been reset, resend every Maestro channel on the next update.
+                std::lock_guard<std::mutex> lock(maestro_mutex);
+                maestro_sent_mask = 0;
             } else {
-                std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                transport->wait_for_device(std::chrono::milliseconds(200));
             }
         }
         else {
             try {
-                uint8_t ch;
-                if (serial_port.read(&ch, 1)) {
-                    if (protocol_unpack_byte(&unpack_data_obj, ch)) {
-                        dispatch_frame(unpack_data_obj.cmd_id, unpack_data_obj.data, unpack_data_obj.data_len);
+                // Wait once for readiness, then drain everything the driver has buffered in a single read.
+                if (transport->wait_readable()) {
+                    size_t bytes_to_read = std::min<size_t>(std::max<size_t>(transport->available(), 1),
+                                                            sizeof(rx_buffer));
+                    size_t bytes_read = transport->read(rx_buffer, bytes_to_read);
+
+                    rx_bytes.fetch_add(bytes_read, std::memory_order_relaxed);
+                    rx_read_calls.fetch_add(1, std::memory_order_relaxed);
+                    capture_recorder.record(CaptureDirection::RX, rx_buffer, bytes_read);
+
+                    uint32_t crc8_before = unpack_data_obj.crc8_errors;
+                    uint32_t crc16_before = unpack_data_obj.crc16_errors;
+                    uint32_t resyncs_before = unpack_data_obj.resyncs;
+
+                    uint32_t frames = protocol_unpack_buffer(&unpack_data_obj, rx_buffer, bytes_read,
+                                           [](void *context, uint16_t cmd_id, const uint8_t *data, uint16_t len) {
+                                               static_cast<HumanoidSDK *>(context)->dispatch_frame(cmd_id, data, len);
+                                           }, this);
+
+                    rx_frames.fetch_add(frames, std::memory_order_relaxed);
+                    if (unpack_data_obj.resyncs != resyncs_before) {
+                        crc8_errors.fetch_add(unpack_data_obj.crc8_errors - crc8_before, std::memory_order_relaxed);
+                        crc16_errors.fetch_add(unpack_data_obj.crc16_errors - crc16_before, std::memory_order_relaxed);
+                        resyncs.fetch_add(unpack_data_obj.resyncs - resyncs_before, std::memory_order_relaxed);
                     }
                 }
             } catch (serial::IOException &e) {
@@ -78,87 +157,636 @@ void HumanoidSDK::communication() {
 }
 
 HumanoidSDK::~HumanoidSDK() {
+    // Timer callbacks (heartbeat, RPC expiry, polling) use members declared after timer_management,
+    // stop them before anything is torn down.
+    timer_management.stop();
+    // Nobody would complete the requests still pending, fail them so every callback runs exactly once.
+    expire_rpcs(std::chrono::steady_clock::time_point::max());
+
     is_running = false;
+    // The RX thread may wait on a full BLOCK subscription.
+    {
+        std::lock_guard<std::mutex> lock(subscription_mutex);
+        for (auto &subscription : frame_subscriptions) {
+            subscription.second->close();
+        }
+        for (auto &subscription : linear_actuator_subscriptions) {
+            subscription.second->close();
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(tx_mutex);
+        tx_condition_variable.notify_one();
+    }
+    transmission_thread.join();
     communication_thread.join();
 }
 
 void HumanoidSDK::dispatch_frame(uint16_t cmd_id, const uint8_t *p_data, uint16_t len) {
-    std::lock_guard<std::mutex> lock(callback_map_mutex);
+    dispatch_table.dispatch(cmd_id, p_data, len);
+    if (subscription_count.load(std::memory_order_relaxed) > 0) {
+        subscription_table.dispatch(cmd_id, p_data, len);
+    }
+}
 
-    std::vector<uint8_t> data(p_data, p_data + len);
+std::shared_ptr<FrameSubscription> HumanoidSDK::subscribe(uint16_t cmd_id, size_t capacity, OverflowPolicy policy) {
+    auto subscription = std::make_shared<FrameSubscription>(capacity, policy);
+    std::lock_guard<std::mutex> update_lock(subscription_update_mutex);
+    {
+        std::lock_guard<std::mutex> lock(subscription_mutex);
+        frame_subscriptions.emplace(cmd_id, subscription);
+    }
+    subscription_count.fetch_add(1, std::memory_order_relaxed);
+    update_subscription_handler(cmd_id);
+    return subscription;
+}
 
-    if (callback_map.count(cmd_id) > 0) {
-        callback_map[cmd_id](data);
+std::shared_ptr<LinearActuatorSubscription> HumanoidSDK::subscribe_linear_actuator(uint8_t id, size_t capacity,
+                                                                                   OverflowPolicy policy) {
+    auto subscription = std::make_shared<LinearActuatorSubscription>(capacity, policy);
+    std::lock_guard<std::mutex> update_lock(subscription_update_mutex);
+    {
+        std::lock_guard<std::mutex> lock(subscription_mutex);
+        linear_actuator_subscriptions.emplace_back(id, subscription);
+    }
+    subscription_count.fetch_add(1, std::memory_order_relaxed);
+    update_subscription_handler(CMD_LINEAR_ACTUATOR_RESPONSE);
+    return subscription;
+}
+
+void HumanoidSDK::unsubscribe(const std::shared_ptr<FrameSubscription> &subscription) {
+    // Release the RX thread first if it waits on this queue, replacing the handler waits for the dispatch to end.
+    subscription->close();
+    std::lock_guard<std::mutex> update_lock(subscription_update_mutex);
+    bool found = false;
+    uint16_t cmd_id = 0;
+    {
+        std::lock_guard<std::mutex> lock(subscription_mutex);
+        for (auto it = frame_subscriptions.begin(); it != frame_subscriptions.end(); ++it) {
+            if (it->second == subscription) {
+                cmd_id = it->first;
+                frame_subscriptions.erase(it);
+                found = true;
+                break;
+            }
+        }
+    }
+    if (found) {
+        subscription_count.fetch_sub(1, std::memory_order_relaxed);
+        update_subscription_handler(cmd_id);
+    }
+}
+
+void HumanoidSDK::unsubscribe(const std::shared_ptr<LinearActuatorSubscription> &subscription) {
+    subscription->close();
+    std::lock_guard<std::mutex> update_lock(subscription_update_mutex);
+    bool found = false;
+    {
+        std::lock_guard<std::mutex> lock(subscription_mutex);
+        auto it = std::find_if(linear_actuator_subscriptions.begin(), linear_actuator_subscriptions.end(),
+                               [&subscription](const std::pair<uint8_t, std::shared_ptr<LinearActuatorSubscription>> &s) {
+            return s.second == subscription;
+        });
+        if (it != linear_actuator_subscriptions.end()) {
+            linear_actuator_subscriptions.erase(it);
+            found = true;
+        }
+    }
+    if (found) {
+        subscription_count.fetch_sub(1, std::memory_order_relaxed);
+        update_subscription_handler(CMD_LINEAR_ACTUATOR_RESPONSE);
+    }
+}
+
+void HumanoidSDK::update_subscription_handler(uint16_t cmd_id) {
+    // The handler owns a snapshot of the subscribers, so the RX thread never touches the lists.
+    std::vector<std::shared_ptr<FrameSubscription>> frames;
+    std::vector<std::pair<uint8_t, std::shared_ptr<LinearActuatorSubscription>>> actuators;
+    {
+        std::lock_guard<std::mutex> lock(subscription_mutex);
+        auto range = frame_subscriptions.equal_range(cmd_id);
+        for (auto it = range.first; it != range.second; ++it) {
+            frames.push_back(it->second);
+        }
+        if (cmd_id == CMD_LINEAR_ACTUATOR_RESPONSE) {
+            actuators.assign(linear_actuator_subscriptions.begin(), linear_actuator_subscriptions.end());
+        }
+    }
+
+    if (frames.empty() && actuators.empty()) {
+        subscription_table.remove(cmd_id);
+        return;
     }
 
+    subscription_table.set(cmd_id, [cmd_id, frames, actuators](const uint8_t *p_data, uint16_t len) {
+        auto now = std::chrono::steady_clock::now();
+        if (!frames.empty()) {
+            ReceivedFrame frame{};
+            frame.timestamp = now;
+            frame.cmd_id = cmd_id;
+            frame.len = std::min<uint16_t>(len, sizeof(frame.data));
+            memcpy(frame.data, p_data, frame.len);
+            for (auto &subscription : frames) {
+                subscription->push(frame);
+            }
+        }
+        if (!actuators.empty() && len >= sizeof(cmd_linear_actuator_feedback_t)) {
+            cmd_linear_actuator_feedback_t res;
+            memcpy(&res, p_data, sizeof(res));
+            LinearActuatorSample sample;
+            sample.timestamp = now;
+            linear_actuator_response_to_feedback(res, sample.feedback);
+            for (auto &subscription : actuators) {
+                if (subscription.first == res.id) {
+                    subscription.second->push(sample);
+                }
+            }
+        }
+    });
 }
 
 bool HumanoidSDK::is_connected() {
-    return serial_port.isOpen();
+    return transport->is_open();
+}
+
+CommunicationStatistics HumanoidSDK::get_communication_statistics() {
+    CommunicationStatistics statistics;
+    statistics.rx_bytes = rx_bytes.load(std::memory_order_relaxed);
+    statistics.rx_read_calls = rx_read_calls.load(std::memory_order_relaxed);
+    statistics.tx_bytes = tx_bytes.load(std::memory_order_relaxed);
+    statistics.tx_write_calls = tx_write_calls.load(std::memory_order_relaxed);
+    statistics.tx_dropped_frames = tx_dropped_frames.load(std::memory_order_relaxed);
+    return statistics;
+}
+
+bool HumanoidSDK::start_capture(const std::string &path) {
+    return capture_recorder.start(path);
+}
+
+void HumanoidSDK::stop_capture() {
+    capture_recorder.stop();
+}
+
+Metrics HumanoidSDK::get_metrics() {
+    Metrics metrics;
+    metrics.rx_bytes = rx_bytes.load(std::memory_order_relaxed);
+    metrics.rx_read_calls = rx_read_calls.load(std::memory_order_relaxed);
+    metrics.rx_frames = rx_frames.load(std::memory_order_relaxed);
+    metrics.tx_bytes = tx_bytes.load(std::memory_order_relaxed);
+    metrics.tx_write_calls = tx_write_calls.load(std::memory_order_relaxed);
+    metrics.tx_frames = tx_frames.load(std::memory_order_relaxed);
+    metrics.tx_dropped_frames = tx_dropped_frames.load(std::memory_order_relaxed);
+    metrics.crc8_errors = crc8_errors.load(std::memory_order_relaxed);
+    metrics.crc16_errors = crc16_errors.load(std::memory_order_relaxed);
+    metrics.resyncs = resyncs.load(std::memory_order_relaxed);
+    metrics.rpc_timeouts = rpc_timeouts.load(std::memory_order_relaxed);
+    metrics.serial_errors = serial_errors.load(std::memory_order_relaxed);
+    metrics.reconnects = reconnects.load(std::memory_order_relaxed);
+    metrics.tx_queue_depth = tx_queue.size();
+    metrics.tx_queue_depth_max = tx_queue_depth_max.load(std::memory_order_relaxed);
+    metrics.console_dropped_bytes = console_buffer.dropped_bytes();
+    metrics.reconnect_time = reconnect_time.snapshot();
+
+    std::lock_guard<std::mutex> lock(pending_rpc_mutex);
+    for (auto &latency : rpc_latency) {
+        metrics.rpc_latency[latency.first] = latency.second->snapshot();
+    }
+    return metrics;
 }
 
 size_t HumanoidSDK::send_cmd_with_data(uint16_t cmd_id, const uint8_t *p_data, uint16_t len) {
-    static uint8_t frame_buffer[PROTOCOL_FRAME_MAX_SIZE];
+    size_t queued = queue_cmd_with_data(cmd_id, p_data, len);
+    flush_tx_queue();
+    return queued;
+}
 
+size_t HumanoidSDK::queue_cmd_with_data(uint16_t cmd_id, const uint8_t *p_data, uint16_t len) {
     if (len > PROTOCOL_DATA_MAX_SIZE)
         len = PROTOCOL_DATA_MAX_SIZE;
 
-    uint32_t frame_size = protocol_pack_data_to_buffer(cmd_id, p_data, len, frame_buffer);
+    if (!tx_queue.push(cmd_id, p_data, len)) {
+        tx_dropped_frames.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+    tx_frames.fetch_add(1, std::memory_order_relaxed);
 
-    if (serial_port.isOpen()) {
-        try {
-            serial_port.write(frame_buffer, frame_size);
-        } catch (serial::IOException &e) {
-            handle_serial_error(e);
-            return 0;
+    return len;
+}
+
+void HumanoidSDK::flush_tx_queue() {
+    // Pairs with the fence in transmission(): either the writer sees the new frames or we see it sleeping.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (tx_writer_sleeping.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(tx_mutex);
+        tx_condition_variable.notify_one();
+    }
+}
+
+void HumanoidSDK::transmission() {
+    uint8_t tx_buffer[TX_BUFFER_SIZE];
+
+    if (tx_cpu >= 0) {
+        pin_current_thread(tx_cpu, "TX thread");
+    }
+
+    while (is_running) {
+        size_t depth = tx_queue.size();
+        if (depth > tx_queue_depth_max.load(std::memory_order_relaxed)) {
+            tx_queue_depth_max.store(depth, std::memory_order_relaxed);
+        }
+
+        // Coalesce everything queued so far into a single write.
+        size_t size = tx_queue.pop_frames(tx_buffer, sizeof(tx_buffer));
+
+        if (size == 0) {
+            std::unique_lock<std::mutex> lock(tx_mutex);
+            tx_writer_sleeping.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (tx_queue.empty() && is_running) {
+                tx_condition_variable.wait_for(lock, std::chrono::milliseconds(100));
+            }
+            tx_writer_sleeping.store(false, std::memory_order_relaxed);
+            continue;
+        }
+
+        // Frames queued while the port is closed are dropped, stale commands must not be sent on reconnect.
+        if (transport->is_open()) {
+            try {
+                transport->write(tx_buffer, size);
+                tx_bytes.fetch_add(size, std::memory_order_relaxed);
+                tx_write_calls.fetch_add(1, std::memory_order_relaxed);
+                capture_recorder.record(CaptureDirection::TX, tx_buffer, size);
+            } catch (serial::IOException &e) {
+                handle_serial_error(e);
+            }
         }
     }
+}
 
-    return len;
+void HumanoidSDK::register_cmd_callback(uint16_t cmd_id, FrameCallback callback) {
+    dispatch_table.set(cmd_id, std::move(callback));
 }
 
 void HumanoidSDK::register_cmd_callback(uint16_t cmd_id, ReceivedCallback callback) {
-    std::lock_guard<std::mutex> lock(callback_map_mutex);
-    callback_map[cmd_id] = std::move(callback);
+    register_cmd_callback(cmd_id, [callback = std::move(callback)](const uint8_t *p_data, uint16_t len) {
+        callback(std::vector<uint8_t>(p_data, p_data + len));
+    });
 }
 
 void HumanoidSDK::remove_cmd_callback(uint16_t cmd_id) {
-    std::lock_guard<std::mutex> lock(callback_map_mutex);
-    callback_map.erase(cmd_id);
+    dispatch_table.remove(cmd_id);
+}
+
+RpcHandle HumanoidSDK::register_rpc(uint16_t request_cmd_id, const void *request_data, uint16_t request_size,
+                                    uint16_t response_cmd_id, uint8_t response_tag,
+                                    const std::chrono::milliseconds &timeout, RpcCallback callback, bool &deferred) {
+    std::lock_guard<std::mutex> lock(pending_rpc_mutex);
+
+    auto slot = std::find_if(pending_rpcs.begin(), pending_rpcs.end(), [](const PendingRpc &p) {
+        return p.state == PendingRpc::FREE;
+    });
+    if (slot == pending_rpcs.end()) {
+        pending_rpcs.emplace_back();
+        slot = std::prev(pending_rpcs.end());
+    }
+
+    slot->state = PendingRpc::WAITING;
+    slot->key = rpc_key(response_cmd_id, response_tag);
+    slot->handle = ++last_rpc_handle;
+    slot->start = std::chrono::steady_clock::now();
+    slot->deadline = slot->start + timeout;
+    std::unique_ptr<LatencyHistogram> &latency = rpc_latency[request_cmd_id];
+    if (!latency) {
+        latency.reset(new LatencyHistogram());
+    }
+    slot->latency = latency.get();
+    // Assigning here releases the previous callback on the caller's thread, never on the RX thread.
+    slot->callback = std::move(callback);
+
+    // Checked under pending_rpc_mutex, which send_deferred_rpcs() takes after the poll is consumed.
+    deferred = response_cmd_id == CMD_LINEAR_ACTUATOR_RESPONSE && outstanding_polls[response_tag].load() > 0;
+    slot->deferred = deferred;
+    if (deferred) {
+        slot->request_cmd_id = request_cmd_id;
+        slot->request_size = std::min<uint16_t>(request_size, sizeof(slot->request));
+        memcpy(slot->request, request_data, slot->request_size);
+        deferred_rpc_count.fetch_add(1);
+    }
+
+    return slot->handle;
+}
+
+bool HumanoidSDK::cancel_rpc(RpcHandle handle) {
+    std::lock_guard<std::mutex> lock(pending_rpc_mutex);
+    for (auto &p : pending_rpcs) {
+        if (p.state == PendingRpc::WAITING && p.handle == handle) {
+            p.state = PendingRpc::FREE;
+            drop_deferred_request(p);
+            return true;
+        }
+    }
+    return false;
+}
+
+RpcHandle HumanoidSDK::rpc_call_async(uint16_t request_cmd_id, const void *request_data, uint16_t request_size,
+                                      uint16_t response_cmd_id, uint8_t response_tag,
+                                      const std::chrono::milliseconds &timeout, RpcCallback callback) {
+    bool deferred;
+    RpcHandle handle = register_rpc(request_cmd_id, request_data, request_size, response_cmd_id, response_tag, timeout,
+                                    std::move(callback), deferred);
+    if (!deferred) {
+        send_cmd_with_data(request_cmd_id, (const uint8_t *) request_data, request_size);
+    }
+    return handle;
 }
 
 bool HumanoidSDK::rpc_call(uint16_t request_cmd_id, const void *request_data, uint16_t request_size,
-                           uint16_t response_cmd_id, void *response_data, const std::chrono::milliseconds &timeout) {
-    std::mutex rpc_mutex;
-    std::condition_variable rpc_condition_variable;
+                           uint16_t response_cmd_id, uint8_t response_tag, void *response_data,
+                           uint16_t response_size, const std::chrono::milliseconds &timeout) {
+    struct Waiter {
+        std::mutex mutex;
+        std::condition_variable condition_variable;
+        bool completed{false};
+        bool success{false};
+        uint16_t response_size{0};
+        uint8_t response[PROTOCOL_DATA_MAX_SIZE];
+    };
+    auto waiter = std::make_shared<Waiter>();
 
-    register_cmd_callback(response_cmd_id, [&](const std::vector<uint8_t> &data) {
-        {
-            std::lock_guard<std::mutex> lock(rpc_mutex);
-            memcpy(response_data, data.data(), data.size());
+    RpcHandle handle = rpc_call_async(request_cmd_id, request_data, request_size, response_cmd_id, response_tag, timeout,
+                                      [waiter](bool success, const uint8_t *p_data, uint16_t len) {
+        std::lock_guard<std::mutex> lock(waiter->mutex);
+        if (success) {
+            waiter->response_size = std::min<uint16_t>(len, sizeof(waiter->response));
+            memcpy(waiter->response, p_data, waiter->response_size);
         }
-        rpc_condition_variable.notify_one();
+        waiter->success = success;
+        waiter->completed = true;
+        waiter->condition_variable.notify_one();
     });
 
-    send_cmd_with_data(request_cmd_id, (uint8_t*)request_data, request_size);
+    std::unique_lock<std::mutex> lock(waiter->mutex);
+    auto completed = [&waiter]() { return waiter->completed; };
+    if (!waiter->condition_variable.wait_for(lock, timeout, completed)) {
+        lock.unlock();
+        if (cancel_rpc(handle)) {
+            rpc_timeouts.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        // The response is being delivered right now, wait for it.
+        lock.lock();
+        waiter->condition_variable.wait(lock, completed);
+    }
+
+    if (!waiter->success) {
+        return false;
+    }
+    memcpy(response_data, waiter->response, std::min(response_size, waiter->response_size));
+    return true;
+}
 
-    std::cv_status ret;
+void HumanoidSDK::complete_rpc(uint16_t response_cmd_id, uint8_t response_tag, const uint8_t *p_data, uint16_t len) {
+    PendingRpc *pending = nullptr;
     {
-        std::unique_lock<std::mutex> lk(rpc_mutex);
-        ret = rpc_condition_variable.wait_for(lk, timeout);
+        std::lock_guard<std::mutex> lock(pending_rpc_mutex);
+
+        // Handles increase monotonically, so concurrent calls to the same actuator complete FIFO.
+        uint32_t key = rpc_key(response_cmd_id, response_tag);
+        for (auto &p : pending_rpcs) {
+            if (p.state == PendingRpc::WAITING && p.key == key && (pending == nullptr || p.handle < pending->handle)) {
+                pending = &p;
+            }
+        }
+        if (pending == nullptr) {
+            return;
+        }
+        pending->state = PendingRpc::COMPLETING;
     }
 
-    remove_cmd_callback(response_cmd_id);
+    pending->latency->record(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - pending->start));
 
-    if (ret == std::cv_status::timeout) {
-        return false;
+    // Run the callback without the lock so it may issue new RPCs.
+    pending->callback(true, p_data, len);
+
+    std::lock_guard<std::mutex> lock(pending_rpc_mutex);
+    pending->state = PendingRpc::FREE;
+}
+
+void HumanoidSDK::expire_rpcs(std::chrono::steady_clock::time_point now) {
+    std::vector<PendingRpc *> expired;
+    {
+        std::lock_guard<std::mutex> lock(pending_rpc_mutex);
+        for (auto &p : pending_rpcs) {
+            if (p.state == PendingRpc::WAITING && p.deadline <= now) {
+                p.state = PendingRpc::COMPLETING;
+                drop_deferred_request(p);
+                expired.push_back(&p);
+            }
+        }
     }
-    return true;
+
+    rpc_timeouts.fetch_add(expired.size(), std::memory_order_relaxed);
+    for (PendingRpc *pending : expired) {
+        pending->callback(false, nullptr, 0);
+    }
+
+    std::lock_guard<std::mutex> lock(pending_rpc_mutex);
+    for (PendingRpc *pending : expired) {
+        pending->state = PendingRpc::FREE;
+    }
+}
+
+void HumanoidSDK::linear_actuator_start_polling(const std::vector<uint8_t> &ids, double rate_hz) {
+    linear_actuator_stop_polling();
+
+    // Each poll costs one query frame on the TX line, 10 bits per byte with 8N1.
+    double max_rate = POLLING_MAX_BUS_SHARE * SERIAL_BAUDRATE / 10.0 /
+                      protocol_calculate_frame_size(sizeof(cmd_linear_actuator_query_state_t));
+
+    std::lock_guard<std::mutex> lock(polling_mutex);
+    if (ids.empty() || rate_hz <= 0) {
+        return;
+    }
+    polling_ids = ids;
+    polling_cursor = 0;
+    polling_rate = std::min(rate_hz, max_rate);
+    polling_budget = 0;
+    polling_last_tick = std::chrono::steady_clock::now();
+    polling_timer = timer_management.add_timer([this]() {
+        poll_linear_actuators();
+    }, std::chrono::milliseconds(1));
+}
+
+void HumanoidSDK::linear_actuator_stop_polling() {
+    std::lock_guard<std::mutex> lock(polling_mutex);
+    if (polling_timer != 0) {
+        timer_management.cancel_timer(polling_timer);
+        polling_timer = 0;
+    }
+    polling_ids.clear();
+    // Forget the polls already lost, so they do not hold back the next RPC. Those still in flight are consumed by
+    // their responses, or expired by the RPC timer.
+    expire_polls(std::chrono::steady_clock::now());
+}
+
+void HumanoidSDK::poll_linear_actuators() {
+    std::lock_guard<std::mutex> lock(polling_mutex);
+    if (polling_ids.empty()) {
+        return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    polling_budget += polling_rate * std::chrono::duration<double>(now - polling_last_tick).count();
+    polling_last_tick = now;
+    // Do not save up more than one round, a stall must not turn into a burst.
+    polling_budget = std::min(polling_budget, (double) polling_ids.size());
+    if (polling_budget < 1.0 || tx_queue.size() > POLLING_MAX_TX_BACKLOG) {
+        return;
+    }
+
+    // Actuators with an RPC in flight are skipped, their response would be ambiguous.
+    bool busy[256] = {};
+    {
+        std::lock_guard<std::mutex> rpc_lock(pending_rpc_mutex);
+        for (auto &p : pending_rpcs) {
+            if (p.state != PendingRpc::FREE && (p.key >> 8) == CMD_LINEAR_ACTUATOR_RESPONSE) {
+                busy[p.key & 0xff] = true;
+            }
+        }
+    }
+
+    int64_t ticks = now.time_since_epoch().count();
+    int64_t lost_before = ticks - poll_timeout();
+    size_t queued = 0;
+    for (size_t tried = 0; tried < polling_ids.size() && polling_budget >= 1.0; ++tried) {
+        uint8_t id = polling_ids[polling_cursor];
+        polling_cursor = (polling_cursor + 1) % polling_ids.size();
+
+        if (busy[id]) {
+            continue;
+        }
+        if (outstanding_polls[id].load() > 0) {
+            if (poll_sent_at[id].load(std::memory_order_relaxed) > lost_before) {
+                continue;
+            }
+            // The query or its response was lost, stop waiting for it.
+            outstanding_polls[id].store(0);
+        }
+
+        poll_sent_at[id].store(ticks, std::memory_order_relaxed);
+        outstanding_polls[id].fetch_add(1);
+        cmd_linear_actuator_query_state_t req;
+        req.id = id;
+        if (queue_cmd_with_data(CMD_LINEAR_ACTUATOR_QUERY_STATE_REQUEST, (uint8_t *) &req, sizeof(req)) == 0) {
+            outstanding_polls[id].fetch_sub(1);
+            break;
+        }
+        polling_budget -= 1.0;
+        queued++;
+    }
+
+    if (queued > 0) {
+        flush_tx_queue();
+    }
+}
+
+bool HumanoidSDK::consume_poll_response(uint8_t id) {
+    // However late it is, the first response after a poll answers the poll. RPCs to the actuator are deferred
+    // meanwhile, so it can only be the response of an RPC sent before the poll, which the poll response then
+    // answers instead.
+    uint32_t outstanding = outstanding_polls[id].load();
+    while (outstanding > 0) {
+        if (outstanding_polls[id].compare_exchange_weak(outstanding, outstanding - 1)) {
+            int64_t round_trip = poll_round_trip.load(std::memory_order_relaxed);
+            int64_t sample = std::chrono::steady_clock::now().time_since_epoch().count() -
+                             poll_sent_at[id].load(std::memory_order_relaxed);
+            // Follow slower responses at once and faster ones slowly, a poll must not be given up while in flight.
+            poll_round_trip.store(sample > round_trip ? sample : round_trip + (sample - round_trip) / 16,
+                                  std::memory_order_relaxed);
+            if (outstanding == 1 && deferred_rpc_count.load() > 0) {
+                send_deferred_rpcs(id);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+void HumanoidSDK::send_deferred_rpcs(uint8_t id) {
+    {
+        std::lock_guard<std::mutex> lock(pending_rpc_mutex);
+        uint32_t key = rpc_key(CMD_LINEAR_ACTUATOR_RESPONSE, id);
+        // In handle order, the responses complete them in that order.
+        for (;;) {
+            PendingRpc *next = nullptr;
+            for (auto &p : pending_rpcs) {
+                if (p.state == PendingRpc::WAITING && p.deferred && p.key == key &&
+                    (next == nullptr || p.handle < next->handle)) {
+                    next = &p;
+                }
+            }
+            if (next == nullptr) {
+                break;
+            }
+            next->deferred = false;
+            deferred_rpc_count.fetch_sub(1);
+            queue_cmd_with_data(next->request_cmd_id, next->request, next->request_size);
+        }
+    }
+    flush_tx_queue();
+}
+
+void HumanoidSDK::drop_deferred_request(PendingRpc &pending) {
+    if (pending.deferred) {
+        pending.deferred = false;
+        deferred_rpc_count.fetch_sub(1);
+    }
+}
+
+void HumanoidSDK::expire_polls(std::chrono::steady_clock::time_point now) {
+    int64_t lost_before = now.time_since_epoch().count() - poll_timeout();
+    for (size_t id = 0; id < 256; ++id) {
+        uint32_t outstanding = outstanding_polls[id].load();
+        if (outstanding == 0 || poll_sent_at[id].load(std::memory_order_relaxed) > lost_before) {
+            continue;
+        }
+        if (outstanding_polls[id].compare_exchange_strong(outstanding, 0) && deferred_rpc_count.load() > 0) {
+            send_deferred_rpcs((uint8_t) id);
+        }
+    }
+}
+
+int64_t HumanoidSDK::poll_timeout() const {
+    using Ticks = std::chrono::steady_clock::duration;
+    int64_t round_trip = poll_round_trip.load(std::memory_order_relaxed);
+    if (round_trip == 0) {
+        return std::chrono::duration_cast<Ticks>(POLLING_RESPONSE_TIMEOUT).count();
+    }
+    int64_t timeout = 4 * round_trip;
+    timeout = std::max<int64_t>(timeout, std::chrono::duration_cast<Ticks>(POLLING_RESPONSE_TIMEOUT_MIN).count());
+    return std::min<int64_t>(timeout, std::chrono::duration_cast<Ticks>(POLLING_RESPONSE_TIMEOUT).count());
+}
+
+RpcHandle HumanoidSDK::linear_actuator_rpc_call_async(uint16_t request_cmd_id, const void *request_data,
+                                                      uint16_t request_size, uint8_t id,
+                                                      LinearActuatorCallback callback,
+                                                      const std::chrono::milliseconds &timeout) {
+    return rpc_call_async(request_cmd_id, request_data, request_size, CMD_LINEAR_ACTUATOR_RESPONSE, id, timeout,
+                          [callback = std::move(callback)](bool success, const uint8_t *p_data, uint16_t len) {
+        LinearActuatorFeedback feedback{};
+        if (success) {
+            cmd_linear_actuator_feedback_t res{};
+            memcpy(&res, p_data, std::min<size_t>(sizeof(res), len));
+            linear_actuator_response_to_feedback(res, feedback);
+        }
+        callback(success, feedback);
+    });
 }
 
 bool HumanoidSDK::read_uid(std::string &uid) {
     cmd_read_uid_response_t res;
-    if (rpc_call(CMD_READ_UID_REQUEST, nullptr, 0, CMD_READ_UID_RESPONSE, &res, std::chrono::milliseconds(100))) {
+    if (rpc_call(CMD_READ_UID_REQUEST, nullptr, 0, CMD_READ_UID_RESPONSE, 0, &res, sizeof(res), std::chrono::milliseconds(100))) {
         uid = std::string((char *) res.uid, 12);
         return true;
     }
@@ -167,7 +795,7 @@ bool HumanoidSDK::read_uid(std::string &uid) {
 
 bool HumanoidSDK::read_temperature(float &temperature) {
     cmd_read_temperature_response_t res;
-    if (rpc_call(CMD_READ_TEMPERATURE_REQUEST, nullptr, 0, CMD_READ_TEMPERATURE_RESPONSE, &res,
+    if (rpc_call(CMD_READ_TEMPERATURE_REQUEST, nullptr, 0, CMD_READ_TEMPERATURE_RESPONSE, 0, &res, sizeof(res),
                  std::chrono::milliseconds(100))) {
         temperature = res.temperature;
         return true;
@@ -175,12 +803,38 @@ bool HumanoidSDK::read_temperature(float &temperature) {
     return false;
 }
 
+RpcHandle HumanoidSDK::read_uid_async(UidCallback callback, const std::chrono::milliseconds &timeout) {
+    return rpc_call_async(CMD_READ_UID_REQUEST, nullptr, 0, CMD_READ_UID_RESPONSE, 0, timeout,
+                          [callback = std::move(callback)](bool success, const uint8_t *p_data, uint16_t len) {
+        std::string uid;
+        if (success) {
+            cmd_read_uid_response_t res{};
+            memcpy(&res, p_data, std::min<size_t>(sizeof(res), len));
+            uid = std::string((char *) res.uid, 12);
+        }
+        callback(success, uid);
+    });
+}
+
+RpcHandle HumanoidSDK::read_temperature_async(TemperatureCallback callback, const std::chrono::milliseconds &timeout) {
+    return rpc_call_async(CMD_READ_TEMPERATURE_REQUEST, nullptr, 0, CMD_READ_TEMPERATURE_RESPONSE, 0, timeout,
+                          [callback = std::move(callback)](bool success, const uint8_t *p_data, uint16_t len) {
+        float temperature = 0;
+        if (success) {
+            cmd_read_temperature_response_t res{};
+            memcpy(&res, p_data, std::min<size_t>(sizeof(res), len));
+            temperature = res.temperature;
+        }
+        callback(success, temperature);
+    });
+}
+
 bool HumanoidSDK::linear_actuator_set_target(uint8_t id, uint16_t target, LinearActuatorFeedback &feedback) {
     cmd_linear_actuator_set_target_t req;
     req.id = id;
     req.target = target;
     cmd_linear_actuator_feedback_t res;
-    if (rpc_call(CMD_LINEAR_ACTUATOR_SET_TARGET_REQUEST, &req, sizeof(req), CMD_LINEAR_ACTUATOR_RESPONSE, &res,
+    if (rpc_call(CMD_LINEAR_ACTUATOR_SET_TARGET_REQUEST, &req, sizeof(req), CMD_LINEAR_ACTUATOR_RESPONSE, id, &res, sizeof(res),
                  std::chrono::milliseconds(100))) {
         linear_actuator_response_to_feedback(res, feedback);
         return true;
@@ -193,7 +847,7 @@ bool HumanoidSDK::linear_actuator_follow(uint8_t id, uint16_t target, LinearActu
     req.id = id;
     req.target = target;
     cmd_linear_actuator_feedback_t res;
-    if (rpc_call(CMD_LINEAR_ACTUATOR_FOLLOW_REQUEST, &req, sizeof(req), CMD_LINEAR_ACTUATOR_RESPONSE, &res,
+    if (rpc_call(CMD_LINEAR_ACTUATOR_FOLLOW_REQUEST, &req, sizeof(req), CMD_LINEAR_ACTUATOR_RESPONSE, id, &res, sizeof(res),
                  std::chrono::milliseconds(100))) {
         linear_actuator_response_to_feedback(res, feedback);
         return true;
@@ -205,7 +859,7 @@ bool HumanoidSDK::linear_actuator_enable(uint8_t id, LinearActuatorFeedback &fee
     cmd_linear_actuator_enable_t req;
     req.id = id;
     cmd_linear_actuator_feedback_t res;
-    if (rpc_call(CMD_LINEAR_ACTUATOR_ENABLE_REQUEST, &req, sizeof(req), CMD_LINEAR_ACTUATOR_RESPONSE, &res,
+    if (rpc_call(CMD_LINEAR_ACTUATOR_ENABLE_REQUEST, &req, sizeof(req), CMD_LINEAR_ACTUATOR_RESPONSE, id, &res, sizeof(res),
                  std::chrono::milliseconds(100))) {
         linear_actuator_response_to_feedback(res, feedback);
         return true;
@@ -229,7 +883,7 @@ bool HumanoidSDK::linear_actuator_stop(uint8_t id, LinearActuatorFeedback &feedb
     cmd_linear_actuator_stop_t req;
     req.id = id;
     cmd_linear_actuator_feedback_t res;
-    if (rpc_call(CMD_LINEAR_ACTUATOR_STOP_REQUEST, &req, sizeof(req), CMD_LINEAR_ACTUATOR_RESPONSE, &res,
+    if (rpc_call(CMD_LINEAR_ACTUATOR_STOP_REQUEST, &req, sizeof(req), CMD_LINEAR_ACTUATOR_RESPONSE, id, &res, sizeof(res),
                  std::chrono::milliseconds(100))) {
         linear_actuator_response_to_feedback(res, feedback);
         return true;
@@ -241,7 +895,7 @@ bool HumanoidSDK::linear_actuator_pause(uint8_t id, LinearActuatorFeedback &feed
     cmd_linear_actuator_pause_t req;
     req.id = id;
     cmd_linear_actuator_feedback_t res;
-    if (rpc_call(CMD_LINEAR_ACTUATOR_PAUSE_REQUEST, &req, sizeof(req), CMD_LINEAR_ACTUATOR_RESPONSE, &res,
+    if (rpc_call(CMD_LINEAR_ACTUATOR_PAUSE_REQUEST, &req, sizeof(req), CMD_LINEAR_ACTUATOR_RESPONSE, id, &res, sizeof(res),
                  std::chrono::milliseconds(100))) {
         linear_actuator_response_to_feedback(res, feedback);
         return true;
@@ -253,7 +907,7 @@ bool HumanoidSDK::linear_actuator_save_parameters(uint8_t id, LinearActuatorFeed
     cmd_linear_actuator_save_parameters_t req;
     req.id = id;
     cmd_linear_actuator_feedback_t res;
-    if (rpc_call(CMD_LINEAR_ACTUATOR_SAVE_PARAMETERS_REQUEST, &req, sizeof(req), CMD_LINEAR_ACTUATOR_RESPONSE, &res,
+    if (rpc_call(CMD_LINEAR_ACTUATOR_SAVE_PARAMETERS_REQUEST, &req, sizeof(req), CMD_LINEAR_ACTUATOR_RESPONSE, id, &res, sizeof(res),
                  std::chrono::milliseconds(100))) {
         linear_actuator_response_to_feedback(res, feedback);
         return true;
@@ -265,7 +919,7 @@ bool HumanoidSDK::linear_actuator_query_state(uint8_t id, LinearActuatorFeedback
     cmd_linear_actuator_query_state_t req;
     req.id = id;
     cmd_linear_actuator_feedback_t res;
-    if (rpc_call(CMD_LINEAR_ACTUATOR_QUERY_STATE_REQUEST, &req, sizeof(req), CMD_LINEAR_ACTUATOR_RESPONSE, &res,
+    if (rpc_call(CMD_LINEAR_ACTUATOR_QUERY_STATE_REQUEST, &req, sizeof(req), CMD_LINEAR_ACTUATOR_RESPONSE, id, &res, sizeof(res),
                  std::chrono::milliseconds(100))) {
         linear_actuator_response_to_feedback(res, feedback);
         return true;
@@ -277,7 +931,7 @@ bool HumanoidSDK::linear_actuator_clear_error(uint8_t id, LinearActuatorFeedback
     cmd_linear_actuator_clear_error_t req;
     req.id = id;
     cmd_linear_actuator_feedback_t res;
-    if (rpc_call(CMD_LINEAR_ACTUATOR_CLEAR_ERROR_REQUEST, &req, sizeof(req), CMD_LINEAR_ACTUATOR_RESPONSE, &res,
+    if (rpc_call(CMD_LINEAR_ACTUATOR_CLEAR_ERROR_REQUEST, &req, sizeof(req), CMD_LINEAR_ACTUATOR_RESPONSE, id, &res, sizeof(res),
                  std::chrono::milliseconds(100))) {
         linear_actuator_response_to_feedback(res, feedback);
         return true;
@@ -285,38 +939,294 @@ bool HumanoidSDK::linear_actuator_clear_error(uint8_t id, LinearActuatorFeedback
     return false;
 }
 
+bool HumanoidSDK::linear_actuator_cached_state(uint8_t id, LinearActuatorFeedback &feedback,
+                                               std::chrono::steady_clock::time_point &timestamp) {
+    cmd_linear_actuator_feedback_t res;
+    if (feedback_cache.read(id, res, timestamp)) {
+        linear_actuator_response_to_feedback(res, feedback);
+        return true;
+    }
+    return false;
+}
+
+bool HumanoidSDK::linear_actuator_cached_state(uint8_t id, LinearActuatorFeedback &feedback,
+                                               const std::chrono::milliseconds &max_age) {
+    std::chrono::steady_clock::time_point timestamp;
+    if (!linear_actuator_cached_state(id, feedback, timestamp)) {
+        return false;
+    }
+    return std::chrono::steady_clock::now() - timestamp <= max_age;
+}
+
+RpcHandle HumanoidSDK::linear_actuator_set_target_async(uint8_t id, uint16_t target, LinearActuatorCallback callback,
+                                                    const std::chrono::milliseconds &timeout) {
+    cmd_linear_actuator_set_target_t req;
+    req.id = id;
+    req.target = target;
+    return linear_actuator_rpc_call_async(CMD_LINEAR_ACTUATOR_SET_TARGET_REQUEST, &req, sizeof(req), id, std::move(callback),
+                                          timeout);
+}
+
+RpcHandle HumanoidSDK::linear_actuator_follow_async(uint8_t id, uint16_t target, LinearActuatorCallback callback,
+                                                    const std::chrono::milliseconds &timeout) {
+    cmd_linear_actuator_follow_t req;
+    req.id = id;
+    req.target = target;
+    return linear_actuator_rpc_call_async(CMD_LINEAR_ACTUATOR_FOLLOW_REQUEST, &req, sizeof(req), id, std::move(callback),
+                                          timeout);
+}
+
+RpcHandle HumanoidSDK::linear_actuator_enable_async(uint8_t id, LinearActuatorCallback callback,
+                                                    const std::chrono::milliseconds &timeout) {
+    cmd_linear_actuator_enable_t req;
+    req.id = id;
+    return linear_actuator_rpc_call_async(CMD_LINEAR_ACTUATOR_ENABLE_REQUEST, &req, sizeof(req), id, std::move(callback),
+                                          timeout);
+}
+
+RpcHandle HumanoidSDK::linear_actuator_stop_async(uint8_t id, LinearActuatorCallback callback,
+                                                    const std::chrono::milliseconds &timeout) {
+    cmd_linear_actuator_stop_t req;
+    req.id = id;
+    return linear_actuator_rpc_call_async(CMD_LINEAR_ACTUATOR_STOP_REQUEST, &req, sizeof(req), id, std::move(callback),
+                                          timeout);
+}
+
+RpcHandle HumanoidSDK::linear_actuator_pause_async(uint8_t id, LinearActuatorCallback callback,
+                                                    const std::chrono::milliseconds &timeout) {
+    cmd_linear_actuator_pause_t req;
+    req.id = id;
+    return linear_actuator_rpc_call_async(CMD_LINEAR_ACTUATOR_PAUSE_REQUEST, &req, sizeof(req), id, std::move(callback),
+                                          timeout);
+}
+
+RpcHandle HumanoidSDK::linear_actuator_save_parameters_async(uint8_t id, LinearActuatorCallback callback,
+                                                    const std::chrono::milliseconds &timeout) {
+    cmd_linear_actuator_save_parameters_t req;
+    req.id = id;
+    return linear_actuator_rpc_call_async(CMD_LINEAR_ACTUATOR_SAVE_PARAMETERS_REQUEST, &req, sizeof(req), id, std::move(callback),
+                                          timeout);
+}
+
+RpcHandle HumanoidSDK::linear_actuator_query_state_async(uint8_t id, LinearActuatorCallback callback,
+                                                    const std::chrono::milliseconds &timeout) {
+    cmd_linear_actuator_query_state_t req;
+    req.id = id;
+    return linear_actuator_rpc_call_async(CMD_LINEAR_ACTUATOR_QUERY_STATE_REQUEST, &req, sizeof(req), id, std::move(callback),
+                                          timeout);
+}
+
+RpcHandle HumanoidSDK::linear_actuator_clear_error_async(uint8_t id, LinearActuatorCallback callback,
+                                                    const std::chrono::milliseconds &timeout) {
+    cmd_linear_actuator_clear_error_t req;
+    req.id = id;
+    return linear_actuator_rpc_call_async(CMD_LINEAR_ACTUATOR_CLEAR_ERROR_REQUEST, &req, sizeof(req), id, std::move(callback),
+                                          timeout);
+}
+
+std::vector<bool> HumanoidSDK::linear_actuator_query_states(const std::vector<uint8_t> &ids,
+                                                           std::vector<LinearActuatorFeedback> &feedbacks,
+                                                           const std::chrono::milliseconds &timeout) {
+    struct Waiter {
+        std::mutex mutex;
+        std::condition_variable condition_variable;
+        size_t remaining;
+        std::vector<bool> success;
+        std::vector<LinearActuatorFeedback> feedbacks;
+    };
+    auto waiter = std::make_shared<Waiter>();
+    waiter->remaining = ids.size();
+    waiter->success.resize(ids.size(), false);
+    waiter->feedbacks.resize(ids.size());
+
+    std::vector<RpcHandle> handles(ids.size());
+
+    for (size_t i = 0; i < ids.size(); ++i) {
+        cmd_linear_actuator_query_state_t req;
+        req.id = ids[i];
+        bool deferred;
+        handles[i] = register_rpc(CMD_LINEAR_ACTUATOR_QUERY_STATE_REQUEST, &req, sizeof(req),
+                                  CMD_LINEAR_ACTUATOR_RESPONSE, ids[i],
+                                  timeout, [waiter, i](bool success, const uint8_t *p_data, uint16_t len) {
+            std::lock_guard<std::mutex> lock(waiter->mutex);
+            if (success) {
+                cmd_linear_actuator_feedback_t res{};
+                memcpy(&res, p_data, std::min<size_t>(sizeof(res), len));
+                linear_actuator_response_to_feedback(res, waiter->feedbacks[i]);
+                waiter->success[i] = true;
+            }
+            if (--waiter->remaining == 0) {
+                waiter->condition_variable.notify_one();
+            }
+        }, deferred);
+
+        if (!deferred) {
+            queue_cmd_with_data(CMD_LINEAR_ACTUATOR_QUERY_STATE_REQUEST, (uint8_t*)&req, sizeof(req));
+        }
+    }
+    // Wake the writer once so all requests leave in the same write.
+    flush_tx_queue();
+
+    std::unique_lock<std::mutex> lock(waiter->mutex);
+    auto completed = [&waiter]() { return waiter->remaining == 0; };
+    if (!waiter->condition_variable.wait_for(lock, timeout, completed)) {
+        // Stragglers are reported as timed out, requests already being delivered are waited for.
+        lock.unlock();
+        for (size_t i = 0; i < ids.size(); ++i) {
+            if (cancel_rpc(handles[i])) {
+                rpc_timeouts.fetch_add(1, std::memory_order_relaxed);
+                std::lock_guard<std::mutex> cancel_lock(waiter->mutex);
+                waiter->remaining--;
+            }
+        }
+        lock.lock();
+        waiter->condition_variable.wait(lock, completed);
+    }
+
+    feedbacks = waiter->feedbacks;
+    return waiter->success;
+}
+
 bool HumanoidSDK::write_console(const std::string &s) {
     auto *ptr = (uint8_t*)s.data();
     size_t len = s.size();
     size_t send_size;
     while(len > 0) {
-        send_size = send_cmd_with_data(CMD_WRITE_CONSOLE, ptr, len);
+        send_size = queue_cmd_with_data(CMD_WRITE_CONSOLE, ptr, std::min<size_t>(len, PROTOCOL_DATA_MAX_SIZE));
+        if (send_size == 0) {
+            break;
+        }
         len -= send_size;
         ptr += send_size;
     }
-    return true;
+    flush_tx_queue();
+    return len == 0;
 }
 
 bool HumanoidSDK::console_output(std::string &s) {
-    s = console_output_stream.str();
-    console_output_stream.str(std::string());
+    console_buffer.read(s);
     return true;
 }
 
+bool HumanoidSDK::console_read_line(std::string &line) {
+    return console_buffer.read_line(line);
+}
+
+void HumanoidSDK::set_console_callback(ConsoleCallback callback) {
+    register_cmd_callback(CMD_CONSOLE_OUTPUT, [this, callback](const uint8_t *p_data, uint16_t len) {
+        console_buffer.write(p_data, len);
+        if (callback) {
+            callback((const char *) p_data, len);
+        }
+    });
+}
+
 bool HumanoidSDK::set_maestro_channel(uint8_t channel, uint16_t target) {
     cmd_set_maestro_channel_t msg;
     msg.channel = channel;
     msg.target = target;
-    send_cmd_with_data(CMD_SET_MAESTRO_CHANNEL, (uint8_t*)&msg, sizeof(msg));
+    std::lock_guard<std::mutex> lock(maestro_mutex);
+    if (send_cmd_with_data(CMD_SET_MAESTRO_CHANNEL, (uint8_t*)&msg, sizeof(msg)) == 0) {
+        return false;
+    }
+    if (channel < MAESTRO_CHANNELS) {
+        maestro_sent_targets[channel] = target;
+        maestro_sent_mask |= 1u << channel;
+    }
     return true;
 }
 
 bool HumanoidSDK::set_maestro_all_channel(const std::vector<uint16_t>& targets) {
-    cmd_set_maestro_all_channel_t msg;
-    for (size_t i = 0; i < std::min<size_t>(targets.size(), 24); ++i) {
-        msg.targets[i] = targets[i];
+    std::lock_guard<std::mutex> lock(maestro_mutex);
+    for (size_t i = 0; i < std::min(targets.size(), MAESTRO_CHANNELS); ++i) {
+        maestro_targets[i] = targets[i];
+        maestro_dirty_mask |= 1u << i;
+    }
+    return maestro_flush_locked();
+}
+
+void HumanoidSDK::maestro_set_target(uint8_t channel, uint16_t target) {
+    if (channel >= MAESTRO_CHANNELS) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(maestro_mutex);
+    maestro_targets[channel] = target;
+    maestro_dirty_mask |= 1u << channel;
+}
+
+bool HumanoidSDK::maestro_flush() {
+    std::lock_guard<std::mutex> lock(maestro_mutex);
+    return maestro_flush_locked();
+}
+
+bool HumanoidSDK::maestro_flush_locked() {
+    constexpr uint32_t all_channels = (1u << MAESTRO_CHANNELS) - 1;
+
+    uint32_t changed = 0;
+    size_t num_changed = 0;
+    for (size_t i = 0; i < MAESTRO_CHANNELS; ++i) {
+        uint32_t bit = 1u << i;
+        if ((maestro_dirty_mask & bit) &&
+            !((maestro_sent_mask & bit) && maestro_sent_targets[i] == maestro_targets[i])) {
+            changed |= bit;
+            num_changed++;
+        }
+    }
+    maestro_dirty_mask = 0;
+    if (num_changed == 0) {
+        return true;
+    }
+
+    uint32_t single_cost = num_changed * protocol_calculate_frame_size(sizeof(cmd_set_maestro_channel_t));
+    uint32_t masked_cost = protocol_calculate_frame_size(
+            offsetof(cmd_set_maestro_masked_channel_t, targets) + num_changed * sizeof(uint16_t));
+    // Sending every channel is only possible when the board's value of the unchanged ones is known.
+    uint32_t all_cost = ((maestro_sent_mask | changed) == all_channels)
+                        ? protocol_calculate_frame_size(sizeof(cmd_set_maestro_all_channel_t)) : UINT32_MAX;
+
+    bool queued = true;
+    if (single_cost <= masked_cost && single_cost <= all_cost) {
+        for (size_t i = 0; i < MAESTRO_CHANNELS; ++i) {
+            if (changed & (1u << i)) {
+                cmd_set_maestro_channel_t msg;
+                msg.channel = (uint8_t) i;
+                msg.target = maestro_targets[i];
+                queued = queue_cmd_with_data(CMD_SET_MAESTRO_CHANNEL, (uint8_t*)&msg, sizeof(msg)) != 0 && queued;
+            }
+        }
+    } else if (masked_cost <= all_cost) {
+        cmd_set_maestro_masked_channel_t msg;
+        msg.mask[0] = (uint8_t) changed;
+        msg.mask[1] = (uint8_t) (changed >> 8);
+        msg.mask[2] = (uint8_t) (changed >> 16);
+        size_t n = 0;
+        for (size_t i = 0; i < MAESTRO_CHANNELS; ++i) {
+            if (changed & (1u << i)) {
+                msg.targets[n++] = maestro_targets[i];
+            }
+        }
+        uint16_t size = (uint16_t) (offsetof(cmd_set_maestro_masked_channel_t, targets) + n * sizeof(uint16_t));
+        queued = queue_cmd_with_data(CMD_SET_MAESTRO_MASKED_CHANNEL, (uint8_t*)&msg, size) != 0;
+    } else {
+        cmd_set_maestro_all_channel_t msg;
+        for (size_t i = 0; i < MAESTRO_CHANNELS; ++i) {
+            msg.targets[i] = (changed & (1u << i)) ? maestro_targets[i] : maestro_sent_targets[i];
+        }
+        queued = queue_cmd_with_data(CMD_SET_MAESTRO_ALL_CHANNEL, (uint8_t*)&msg, sizeof(msg)) != 0;
+    }
+    flush_tx_queue();
+
+    if (!queued) {
+        // Retry everything on the next flush rather than guessing what the board holds.
+        maestro_dirty_mask = changed;
+        return false;
+    }
+    for (size_t i = 0; i < MAESTRO_CHANNELS; ++i) {
+        if (changed & (1u << i)) {
+            maestro_sent_targets[i] = maestro_targets[i];
+        }
     }
-    send_cmd_with_data(CMD_SET_MAESTRO_ALL_CHANNEL, (uint8_t*)&msg, sizeof(msg));
+    maestro_sent_mask |= changed;
     return true;
 }
 
@@ -336,35 +1246,67 @@ bool HumanoidSDK::linear_actuator_follow_silent(uint8_t id, uint16_t target) {
     return true;
 }
 
-bool HumanoidSDK::linear_actuator_broadcast_targets(const std::vector<uint8_t> &ids,
-                                                        const std::vector<uint16_t> &targets) {
+bool HumanoidSDK::linear_actuator_broadcast(uint16_t cmd_id, const uint8_t *ids, const uint16_t *targets,
+                                            size_t count) {
+    static_assert(sizeof(cmd_linear_actuator_broadcast_targets_t) == sizeof(cmd_linear_actuator_broadcast_follows_t),
+                  "broadcast messages must share one layout");
     cmd_linear_actuator_broadcast_targets_t msg;
-    size_t cnt = std::min<size_t>(std::min<size_t>(ids.size(), targets.size()), 10);
-    for (size_t i = 0; i < cnt; ++i) {
-        msg.num = cnt;
-        msg.ids[i] = ids[i];
-        msg.targets[i] = targets[i];
+    constexpr size_t max_num = sizeof(msg.ids);
+    // The firmware reads targets at a fixed offset, so a frame only drops the unused tail of targets.
+    constexpr size_t header_size = offsetof(cmd_linear_actuator_broadcast_targets_t, targets);
+
+    size_t frames = (count + max_num - 1) / max_num;
+    if (frames == 0) {
+        return true;
+    }
+    size_t first;
+    if (!tx_queue.reserve(frames, first)) {
+        // All or nothing, a partial broadcast would leave some actuators at their old targets.
+        tx_dropped_frames.fetch_add(frames, std::memory_order_relaxed);
+        return false;
+    }
+    for (size_t frame = 0, offset = 0; offset < count; ++frame, offset += max_num) {
+        size_t cnt = std::min(count - offset, max_num);
+        msg.num = (uint8_t) cnt;
+        memset(msg.ids, 0, sizeof(msg.ids));
+        for (size_t i = 0; i < cnt; ++i) {
+            msg.ids[i] = ids[offset + i];
+            msg.targets[i] = targets[offset + i];
+        }
+        uint16_t size = (uint16_t) (header_size + cnt * sizeof(msg.targets[0]));
+        tx_queue.pack(first + frame, cmd_id, (uint8_t*)&msg, size);
     }
-    send_cmd_with_data(CMD_LINEAR_ACTUATOR_BROADCAST_TARGETS, (uint8_t*)&msg, sizeof(msg));
+    tx_queue.publish(first, frames);
+    tx_frames.fetch_add(frames, std::memory_order_relaxed);
+    // The writer sees the frames at once, they leave in the same write unless they overflow TX_BUFFER_SIZE.
+    flush_tx_queue();
     return true;
 }
 
+bool HumanoidSDK::linear_actuator_broadcast_targets(const std::vector<uint8_t> &ids,
+                                                        const std::vector<uint16_t> &targets) {
+    return linear_actuator_broadcast(CMD_LINEAR_ACTUATOR_BROADCAST_TARGETS, ids.data(), targets.data(),
+                                     std::min(ids.size(), targets.size()));
+}
+
 bool HumanoidSDK::linear_actuator_broadcast_follows(const std::vector<uint8_t> &ids, const std::vector<uint16_t> &targets) {
-    cmd_linear_actuator_broadcast_follows_t msg;
-    size_t cnt = std::min<size_t>(std::min<size_t>(ids.size(), targets.size()), 10);
-    for (size_t i = 0; i < cnt; ++i) {
-        msg.num = cnt;
-        msg.ids[i] = ids[i];
-        msg.targets[i] = targets[i];
-    }
-    send_cmd_with_data(CMD_LINEAR_ACTUATOR_BROADCAST_FOLLOWS, (uint8_t*)&msg, sizeof(msg));
-    return true;
+    return linear_actuator_broadcast(CMD_LINEAR_ACTUATOR_BROADCAST_FOLLOWS, ids.data(), targets.data(),
+                                     std::min(ids.size(), targets.size()));
+}
+
+bool HumanoidSDK::linear_actuator_broadcast_targets(const uint8_t *ids, const uint16_t *targets, size_t count) {
+    return linear_actuator_broadcast(CMD_LINEAR_ACTUATOR_BROADCAST_TARGETS, ids, targets, count);
+}
+
+bool HumanoidSDK::linear_actuator_broadcast_follows(const uint8_t *ids, const uint16_t *targets, size_t count) {
+    return linear_actuator_broadcast(CMD_LINEAR_ACTUATOR_BROADCAST_FOLLOWS, ids, targets, count);
 }
 
 void HumanoidSDK::handle_serial_error(serial::IOException &e) {
+    serial_errors.fetch_add(1, std::memory_order_relaxed);
     fmt::print(stderr, "Serial port error: {}\n", e.what());
     try {
-        serial_port.close();
+        transport->close();
     } catch (serial::IOException& ee) {
         fmt::print(stderr, "Close serial port error: {}\n", ee.what());
     }
@@ -0,0 +1,74 @@
+#include "metrics.h"
+#include <algorithm>
+
+using namespace humanoid_sdk;
+
+constexpr size_t LatencyHistogram::BUCKETS;
+
+LatencyHistogram::LatencyHistogram() : count(0), sum_us(0), max_us(0) {
+    for (auto &bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+size_t LatencyHistogram::bucket_index(uint64_t us) {
+    if (us < 16) {
+        return (size_t) us;
+    }
+    size_t exponent = 63;
+    while ((us >> exponent) == 0) {
+        exponent--;
+    }
+    size_t index = 16 + (exponent - 4) * 8 + ((us >> (exponent - 3)) & 7);
+    return std::min(index, BUCKETS - 1);
+}
+
+uint64_t LatencyHistogram::bucket_lower_bound(size_t index) {
+    if (index < 16) {
+        return index;
+    }
+    size_t exponent = (index - 16) / 8 + 4;
+    return (8 + (index - 16) % 8) << (exponent - 3);
+}
+
+void LatencyHistogram::record(std::chrono::microseconds latency) {
+    uint64_t us = (uint64_t) std::max<int64_t>(latency.count(), 0);
+    buckets[bucket_index(us)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sum_us.fetch_add(us, std::memory_order_relaxed);
+    uint64_t current = max_us.load(std::memory_order_relaxed);
+    while (us > current && !max_us.compare_exchange_weak(current, us, std::memory_order_relaxed)) {
+    }
+}
+
+LatencySnapshot LatencyHistogram::snapshot() const {
+    LatencySnapshot snapshot;
+    snapshot.buckets.resize(BUCKETS);
+    uint64_t total = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        snapshot.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+        total += snapshot.buckets[i];
+    }
+    // Derived from the buckets so percentiles are consistent with the count.
+    snapshot.count = total;
+    snapshot.mean = std::chrono::microseconds(total == 0 ? 0 : sum_us.load(std::memory_order_relaxed) / total);
+    snapshot.max = std::chrono::microseconds(max_us.load(std::memory_order_relaxed));
+    return snapshot;
+}
+
+std::chrono::microseconds LatencySnapshot::percentile(double p) const {
+    if (count == 0) {
+        return std::chrono::microseconds(0);
+    }
+    auto rank = (uint64_t) (p / 100.0 * (double) count);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen > rank) {
+            uint64_t upper = i + 1 < LatencyHistogram::BUCKETS ? LatencyHistogram::bucket_lower_bound(i + 1) - 1
+                                                                : (uint64_t) max.count();
+            return std::chrono::microseconds(std::min<uint64_t>(upper, (uint64_t) max.count()));
+        }
+    }
+    return max;
+}
@@ -0,0 +1,199 @@
+#include "simulated_device.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace humanoid_sdk;
+
+SimulatedDevice::SimulatedDevice(const SimulatedDeviceOptions &_options)
+        : options(_options), maestro_targets(), random_engine(_options.seed), received_frame_count(0),
+          dropped_frame_count(0), running(true) {
+    auto ends = LoopbackTransport::create_pair();
+    device_end = std::move(ends.first);
+    host_end = std::move(ends.second);
+    device_end->open();
+
+    device_thread = std::thread(&SimulatedDevice::device_thread_function, this);
+}
+
+SimulatedDevice::~SimulatedDevice() {
+    running = false;
+    device_thread.join();
+}
+
+std::unique_ptr<Transport> SimulatedDevice::host_transport() {
+    return std::move(host_end);
+}
+
+void SimulatedDevice::write_console(const std::string &s) {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    for (size_t offset = 0; offset < s.size(); offset += PROTOCOL_DATA_MAX_SIZE) {
+        respond(CMD_CONSOLE_OUTPUT, s.data() + offset,
+                (uint16_t) std::min<size_t>(s.size() - offset, PROTOCOL_DATA_MAX_SIZE));
+    }
+}
+
+uint16_t SimulatedDevice::maestro_target(uint8_t channel) {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    return channel < 24 ? maestro_targets[channel] : 0;
+}
+
+uint64_t SimulatedDevice::received_frames() const {
+    return received_frame_count.load(std::memory_order_relaxed);
+}
+
+uint64_t SimulatedDevice::dropped_frames() const {
+    return dropped_frame_count.load(std::memory_order_relaxed);
+}
+
+void SimulatedDevice::device_thread_function() {
+    unpack_data_t unpack_data_obj;
+    protocol_initialize_unpack_object(&unpack_data_obj);
+    uint8_t rx_buffer[1024];
+
+    while (running) {
+        std::chrono::microseconds timeout = std::chrono::milliseconds(10);
+        {
+            std::lock_guard<std::mutex> lock(state_mutex);
+            auto now = std::chrono::steady_clock::now();
+            while (!delayed_writes.empty() && delayed_writes.front().due <= now) {
+                device_end->write(delayed_writes.front().bytes.data(), delayed_writes.front().bytes.size());
+                delayed_writes.pop_front();
+            }
+            if (!delayed_writes.empty()) {
+                timeout = std::min(timeout, std::chrono::duration_cast<std::chrono::microseconds>(
+                        delayed_writes.front().due - now) + std::chrono::microseconds(1));
+            }
+        }
+
+        if (device_end->wait_readable(timeout)) {
+            size_t bytes_read = device_end->read(rx_buffer, sizeof(rx_buffer));
+            protocol_unpack_buffer(&unpack_data_obj, rx_buffer, bytes_read,
+                                   [](void *context, uint16_t cmd_id, const uint8_t *data, uint16_t len) {
+                                       static_cast<SimulatedDevice *>(context)->handle_frame(cmd_id, data, len);
+                                   }, this);
+        }
+    }
+}
+
+void SimulatedDevice::handle_frame(uint16_t cmd_id, const uint8_t *p_data, uint16_t len) {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    received_frame_count.fetch_add(1, std::memory_order_relaxed);
+
+    if (options.loss_rate > 0 && std::uniform_real_distribution<double>(0.0, 1.0)(random_engine) < options.loss_rate) {
+        dropped_frame_count.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // Requests shorter than their message are zero extended, like the firmware's fixed size buffers.
+    uint8_t data[PROTOCOL_DATA_MAX_SIZE] = {};
+    memcpy(data, p_data, std::min<size_t>(len, sizeof(data)));
+
+    switch (cmd_id) {
+        case CMD_ECHO_REQUEST:
+            respond(CMD_ECHO_RESPONSE, p_data, len);
+            break;
+        case CMD_READ_UID_REQUEST: {
+            cmd_read_uid_response_t res;
+            memcpy(res.uid, "SIMULATED000", sizeof(res.uid));
+            respond(CMD_READ_UID_RESPONSE, &res, sizeof(res));
+            break;
+        }
+        case CMD_READ_TEMPERATURE_REQUEST: {
+            cmd_read_temperature_response_t res;
+            res.temperature = 36.5f;
+            respond(CMD_READ_TEMPERATURE_RESPONSE, &res, sizeof(res));
+            break;
+        }
+        case CMD_LINEAR_ACTUATOR_SET_TARGET_REQUEST:
+        case CMD_LINEAR_ACTUATOR_FOLLOW_REQUEST: {
+            auto *req = (cmd_linear_actuator_set_target_t *) data;
+            actuators[req->id].target_position = req->target;
+            actuators[req->id].current_position = req->target;
+            respond_linear_actuator(req->id);
+            break;
+        }
+        case CMD_LINEAR_ACTUATOR_CLEAR_ERROR_REQUEST:
+            actuators[data[0]].error_code = 0;
+            respond_linear_actuator(data[0]);
+            break;
+        case CMD_LINEAR_ACTUATOR_ENABLE_REQUEST:
+        case CMD_LINEAR_ACTUATOR_STOP_REQUEST:
+        case CMD_LINEAR_ACTUATOR_PAUSE_REQUEST:
+        case CMD_LINEAR_ACTUATOR_SAVE_PARAMETERS_REQUEST:
+        case CMD_LINEAR_ACTUATOR_QUERY_STATE_REQUEST:
+            respond_linear_actuator(data[0]);
+            break;
+        case CMD_LINEAR_ACTUATOR_SET_TARGET_SILENT:
+        case CMD_LINEAR_ACTUATOR_FOLLOW_SILENT: {
+            auto *msg = (cmd_linear_actuator_set_target_silent_t *) data;
+            actuators[msg->id].target_position = msg->target;
+            actuators[msg->id].current_position = msg->target;
+            break;
+        }
+        case CMD_LINEAR_ACTUATOR_BROADCAST_TARGETS:
+        case CMD_LINEAR_ACTUATOR_BROADCAST_FOLLOWS: {
+            auto *msg = (cmd_linear_actuator_broadcast_targets_t *) data;
+            for (size_t i = 0; i < std::min<size_t>(msg->num, sizeof(msg->ids)); ++i) {
+                actuators[msg->ids[i]].target_position = msg->targets[i];
+                actuators[msg->ids[i]].current_position = msg->targets[i];
+            }
+            break;
+        }
+        case CMD_WRITE_CONSOLE:
+            // The firmware shell echoes its input.
+            respond(CMD_CONSOLE_OUTPUT, p_data, len);
+            break;
+        case CMD_SET_MAESTRO_CHANNEL: {
+            auto *msg = (cmd_set_maestro_channel_t *) data;
+            if (msg->channel < 24) {
+                maestro_targets[msg->channel] = msg->target;
+            }
+            break;
+        }
+        case CMD_SET_MAESTRO_ALL_CHANNEL: {
+            auto *msg = (cmd_set_maestro_all_channel_t *) data;
+            memcpy(maestro_targets, msg->targets, sizeof(maestro_targets));
+            break;
+        }
+        case CMD_SET_MAESTRO_MASKED_CHANNEL: {
+            auto *msg = (cmd_set_maestro_masked_channel_t *) data;
+            size_t n = 0;
+            for (size_t i = 0; i < 24; ++i) {
+                if (msg->mask[i / 8] & (1u << (i % 8))) {
+                    maestro_targets[i] = msg->targets[n++];
+                }
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void SimulatedDevice::respond(uint16_t cmd_id, const void *p_data, uint16_t len) {
+    DelayedWrite write;
+    write.bytes.resize(protocol_calculate_frame_size(len));
+    protocol_pack_data_to_buffer(cmd_id, (const uint8_t *) p_data, len, write.bytes.data());
+
+    std::chrono::microseconds delay = options.latency;
+    if (options.jitter.count() > 0) {
+        delay += std::chrono::microseconds(
+                std::uniform_int_distribution<int64_t>(0, options.jitter.count())(random_engine));
+    }
+    write.due = std::chrono::steady_clock::now() + delay;
+    // The link is a byte stream, a response never overtakes an earlier one.
+    if (!delayed_writes.empty()) {
+        write.due = std::max(write.due, delayed_writes.back().due);
+    }
+    delayed_writes.push_back(std::move(write));
+}
+
+void SimulatedDevice::respond_linear_actuator(uint8_t id) {
+    cmd_linear_actuator_feedback_t res{};
+    res.id = id;
+    res.target_position = actuators[id].target_position;
+    res.current_position = actuators[id].current_position;
+    res.temperature = 35;
+    res.error_code = actuators[id].error_code;
+    respond(CMD_LINEAR_ACTUATOR_RESPONSE, &res, sizeof(res));
+}
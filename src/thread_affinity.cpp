@@ -0,0 +1,41 @@
+#include "thread_affinity.h"
+#include "fmt/format.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <cstring>
+#endif
+
+bool humanoid_sdk::pin_current_thread(int cpu, const char *thread_name) {
+#if defined(__linux__)
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu, &cpu_set);
+    int ret = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+    if (ret != 0) {
+        fmt::print(stderr, "Cannot pin {} to CPU {}: {}\n", thread_name, cpu, strerror(ret));
+        return false;
+    }
+    return true;
+#else
+    fmt::print(stderr, "Cannot pin {} to CPU {}: only supported on Linux\n", thread_name, cpu);
+    return false;
+#endif
+}
+
+bool humanoid_sdk::set_current_thread_realtime_priority(int priority, const char *thread_name) {
+#if defined(__linux__)
+    struct sched_param param{};
+    param.sched_priority = priority;
+    int ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (ret != 0) {
+        fmt::print(stderr, "Cannot set SCHED_FIFO priority {} of {}: {}\n", priority, thread_name, strerror(ret));
+        return false;
+    }
+    return true;
+#else
+    fmt::print(stderr, "Cannot set SCHED_FIFO priority {} of {}: only supported on Linux\n", priority, thread_name);
+    return false;
+#endif
+}
@@ -2,47 +2,109 @@
 #include <algorithm>
 
 void TimerManagement::timer_thread_function() {
-    using namespace std::literals::chrono_literals;
-    std::chrono::time_point<std::chrono::high_resolution_clock> now;
+    std::unique_lock<std::mutex> lock(timers_mutex);
     while (running) {
-        now = std::chrono::high_resolution_clock::now();
-
-        std::vector<ManagedTimer>::iterator next;
-        {
-            std::lock_guard<std::mutex> lock(timers_mutex);
-            for (auto &timer: timers) {
-                if (now - timer.last_time > timer.interval) {
-                    timer.function();
-                    timer.last_time = now;
-                }
-            }
+        if (timers.empty()) {
+            timers_condition_variable.wait(lock);
+            continue;
+        }
+
+        // Woken early by add_timer() when a new timer becomes the earliest one, or on shutdown.
+        Clock::time_point deadline = timers.front().deadline;
+        if (Clock::now() < deadline) {
+            timers_condition_variable.wait_until(lock, deadline);
+            continue;
+        }
+
+        std::pop_heap(timers.begin(), timers.end());
+        std::shared_ptr<ManagedTimer> timer = std::move(timers.back().timer);
+        timers.pop_back();
+        if (timer->cancelled) {
+            continue;
+        }
 
-            next = std::max_element(timers.begin(), timers.end(), [](const ManagedTimer& a, const ManagedTimer& b){
-                return (a.last_time + a.interval) < (b.last_time + b.interval);
-            });
+        running_timer = timer;
+        lock.unlock();
+        timer->function();
+        lock.lock();
+        running_timer.reset();
+
+        if (timer->cancelled) {
+            continue;
+        }
+
+        Clock::time_point now = Clock::now();
+        if (timer->mode == TimerMode::FIXED_RATE) {
+            deadline += timer->interval;
+            if (deadline <= now) {
+                // Fell behind, skip the missed periods instead of running them back to back.
+                deadline += ((now - deadline) / timer->interval + 1) * timer->interval;
+            }
+        } else {
+            deadline = now + timer->interval;
         }
+        schedule(deadline, std::move(timer));
+    }
+}
 
-        std::this_thread::sleep_until(next->last_time + next->interval);
+void TimerManagement::schedule(Clock::time_point deadline, std::shared_ptr<ManagedTimer> timer) {
+    timers.push_back({deadline, std::move(timer)});
+    std::push_heap(timers.begin(), timers.end());
+}
+
+TimerManagement::TimerHandle TimerManagement::add_timer(const std::function<void(void)> &function,
+                                                        const std::chrono::milliseconds &interval, TimerMode mode) {
+    std::lock_guard<std::mutex> lock(timers_mutex);
+    auto timer = std::make_shared<ManagedTimer>(++last_handle, function, interval, mode);
+    Clock::time_point deadline = Clock::now() + timer->interval;
+    bool earliest = timers.empty() || deadline < timers.front().deadline;
+    schedule(deadline, timer);
+    if (earliest) {
+        timers_condition_variable.notify_one();
     }
+    return timer->handle;
 }
 
-void TimerManagement::add_timer(const std::function<void(void)> &function, const std::chrono::milliseconds &interval) {
+bool TimerManagement::cancel_timer(TimerHandle handle) {
     std::lock_guard<std::mutex> lock(timers_mutex);
-    timers.emplace_back(function, interval);
+    if (running_timer && running_timer->handle == handle) {
+        bool was_active = !running_timer->cancelled;
+        running_timer->cancelled = true;
+        return was_active;
+    }
+    // Cancelled entries are dropped lazily when they reach the top of the heap.
+    for (auto &scheduled : timers) {
+        if (scheduled.timer->handle == handle && !scheduled.timer->cancelled) {
+            scheduled.timer->cancelled = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+void TimerManagement::stop() {
+    {
+        std::lock_guard<std::mutex> lock(timers_mutex);
+        running = false;
+        timers_condition_variable.notify_one();
+    }
+    if (timer_thread.joinable()) {
+        timer_thread.join();
+    }
 }
 
 TimerManagement::~TimerManagement() {
-    running = false;
-    timer_thread.join();
+    stop();
 }
 
-TimerManagement::TimerManagement() : running(true), timer_thread(&TimerManagement::timer_thread_function, this) {
+TimerManagement::TimerManagement() : last_handle(0), running(true),
+                                     timer_thread(&TimerManagement::timer_thread_function, this) {
 
 }
 
-TimerManagement::ManagedTimer::ManagedTimer(std::function<void(void)> _function,
-                                            const std::chrono::milliseconds &_interval)
-        : function(std::move(_function)), interval(_interval) {
-    last_time = std::chrono::high_resolution_clock::now();
-}
+TimerManagement::ManagedTimer::ManagedTimer(TimerHandle _handle, std::function<void(void)> _function,
+                                            const std::chrono::milliseconds &_interval, TimerMode _mode)
+        : handle(_handle), function(std::move(_function)),
+          interval(std::max(_interval, std::chrono::milliseconds(1))), mode(_mode) {
 
+}
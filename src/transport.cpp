@@ -0,0 +1,314 @@
+#include "transport.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <set>
+#include "fmt/format.h"
+#include "protocol_definition.h"
+
+using namespace humanoid_sdk;
+
+constexpr uint16_t SerialTransport::DEFAULT_VID;
+constexpr uint16_t SerialTransport::DEFAULT_PID;
+
+// Ports held by a SerialTransport of this process.
+static std::mutex claimed_ports_mutex;
+static std::set<std::string> claimed_ports;
+
+static std::string hex_string(const std::string &bytes) {
+    std::string hex;
+    for (unsigned char c : bytes) {
+        hex += fmt::format("{:02x}", c);
+    }
+    return hex;
+}
+
+// Whether the tty node name belongs to a board, from the sysfs attributes of its USB device.
+static bool usb_tty_matches(const std::string &name, uint16_t vid, uint16_t pid, const std::string &serial_number) {
+    auto read_attribute = [](const std::string &path) {
+        std::ifstream file(path);
+        std::string value;
+        std::getline(file, value);
+        return value;
+    };
+    // ttyACM nodes belong to a USB interface, ttyUSB nodes to a port one level below it.
+    for (const char *usb_device : {"/device/..", "/device/../.."}) {
+        std::string dir = "/sys/class/tty/" + name + usb_device;
+        std::string id_vendor = read_attribute(dir + "/idVendor");
+        if (id_vendor.empty()) {
+            continue;
+        }
+        return strtoul(id_vendor.c_str(), nullptr, 16) == vid &&
+               strtoul(read_attribute(dir + "/idProduct").c_str(), nullptr, 16) == pid &&
+               (serial_number.empty() || read_attribute(dir + "/serial") == serial_number);
+    }
+    return false;
+}
+
+// The serial number token of a hardware_id reading "USB VID:PID=0483:5740 SNR=<serial number>".
+static std::string usb_serial_number(const std::string &hardware_id) {
+    size_t begin = hardware_id.find("SNR=");
+    if (begin == std::string::npos) {
+        return std::string();
+    }
+    begin += 4;
+    size_t end = hardware_id.find(' ', begin);
+    return hardware_id.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+}
+
+SerialTransport::SerialTransport(uint32_t baudrate) {
+    options.baudrate = baudrate;
+}
+
+SerialTransport::SerialTransport(const std::string &port, uint32_t baudrate) {
+    options.port = port;
+    options.baudrate = baudrate;
+}
+
+SerialTransport::SerialTransport(const SerialTransportOptions &_options) : options(_options) {
+
+}
+
+SerialTransport::~SerialTransport() {
+    release_port();
+}
+
+std::vector<std::string> SerialTransport::scan_robots() {
+    std::vector<serial::PortInfo> devices_found = serial::list_ports();
+    std::vector<std::string> ports;
+
+    for (const serial::PortInfo &port_info: devices_found) {
+        if (port_info.vid != DEFAULT_VID || port_info.pid != DEFAULT_PID) {
+            continue;
+        }
+        if (!options.serial_number.empty() && usb_serial_number(port_info.hardware_id) != options.serial_number) {
+            continue;
+        }
+        ports.push_back(port_info.port);
+    }
+
+    return ports;
+}
+
+void SerialTransport::update_known_ports() {
+    // Enumerating reads several sysfs files of every tty, so with hotplug events it is done only once, or again
+    // when events were lost.
+    bool overflowed = false;
+    std::vector<HotplugEvent> events = hotplug_monitor.read_events(overflowed);
+    if (overflowed) {
+        fmt::print(stderr, "Device events were lost, rescanning ports\n");
+        known_ports_valid = false;
+    }
+    if (!known_ports_valid || !hotplug_monitor.available()) {
+        // The events read above happened before the scan, it sees their outcome.
+        known_ports = scan_robots();
+        known_ports_valid = true;
+        return;
+    }
+
+    for (const HotplugEvent &event : events) {
+        std::string port = "/dev/" + event.name;
+        auto it = std::find(known_ports.begin(), known_ports.end(), port);
+        if (event.removed) {
+            if (it != known_ports.end()) {
+                known_ports.erase(it);
+            }
+        } else if (it == known_ports.end() &&
+                   usb_tty_matches(event.name, DEFAULT_VID, DEFAULT_PID, options.serial_number)) {
+            known_ports.push_back(port);
+        }
+    }
+}
+
+void SerialTransport::configure_port(const std::string &port_name) {
+    auto timeout = serial::Timeout::simpleTimeout(200);
+
+    serial_port.setPort(port_name);
+    serial_port.setBaudrate(options.baudrate);
+    serial_port.setTimeout(timeout);
+    serial_port.setBytesize(serial::eightbits);
+    serial_port.setParity(serial::parity_none);
+    serial_port.setStopbits(serial::stopbits_one);
+    serial_port.setFlowcontrol(serial::flowcontrol_none);
+}
+
+bool SerialTransport::probe_uid() {
+    uint8_t frame[PROTOCOL_FRAME_MAX_SIZE];
+    uint32_t frame_size = protocol_pack_data_to_buffer(CMD_READ_UID_REQUEST, nullptr, 0, frame);
+    serial_port.flushInput();
+    serial_port.write(frame, frame_size);
+
+    struct Probe {
+        bool answered{false};
+        std::string uid;
+    } probe;
+    unpack_data_t unpack_data_obj;
+    protocol_initialize_unpack_object(&unpack_data_obj);
+    uint8_t rx_buffer[256];
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(300);
+    while (!probe.answered && std::chrono::steady_clock::now() < deadline) {
+        if (!serial_port.waitReadable()) {
+            continue;
+        }
+        size_t bytes_read = serial_port.read(rx_buffer, std::min<size_t>(std::max<size_t>(serial_port.available(), 1),
+                                                                         sizeof(rx_buffer)));
+        protocol_unpack_buffer(&unpack_data_obj, rx_buffer, bytes_read,
+                               [](void *context, uint16_t cmd_id, const uint8_t *data, uint16_t len) {
+                                   auto *p = static_cast<Probe *>(context);
+                                   if (cmd_id == CMD_READ_UID_RESPONSE && len >= sizeof(cmd_read_uid_response_t)) {
+                                       p->uid.assign((const char *) data, sizeof(cmd_read_uid_response_t));
+                                       p->answered = true;
+                                   }
+                               }, &probe);
+    }
+
+    return probe.answered && (probe.uid == options.uid || hex_string(probe.uid) == options.uid);
+}
+
+bool SerialTransport::open() {
+    std::vector<std::string> candidates;
+    if (options.port.empty()) {
+        update_known_ports();
+        candidates = known_ports;
+    } else {
+        // Nothing else reads the events with an explicit port, unread ones would keep wait_for_device() from waiting.
+        bool overflowed;
+        hotplug_monitor.read_events(overflowed);
+        candidates.push_back(options.port);
+    }
+
+    for (const std::string &port_name : candidates) {
+        {
+            std::lock_guard<std::mutex> lock(claimed_ports_mutex);
+            if (!claimed_ports.insert(port_name).second) {
+                continue;
+            }
+            claimed_port = port_name;
+        }
+
+        try {
+            configure_port(port_name);
+            serial_port.open();
+            if (options.uid.empty() || probe_uid()) {
+                return true;
+            }
+            serial_port.close();
+        } catch (serial::IOException &e) {
+            if (serial_port.isOpen()) {
+                serial_port.close();
+            }
+            release_port();
+            // Another board may still match, report only if this was the last candidate.
+            if (&port_name == &candidates.back()) {
+                throw;
+            }
+            continue;
+        }
+        release_port();
+    }
+
+    return false;
+}
+
+void SerialTransport::release_port() {
+    // close() also runs on the SDK TX thread after a write error, while the RX thread may be in open().
+    std::lock_guard<std::mutex> lock(claimed_ports_mutex);
+    if (claimed_port.empty()) {
+        return;
+    }
+    claimed_ports.erase(claimed_port);
+    claimed_port.clear();
+}
+
+void SerialTransport::close() {
+    serial_port.close();
+    release_port();
+}
+
+bool SerialTransport::is_open() {
+    return serial_port.isOpen();
+}
+
+std::string SerialTransport::name() {
+    return serial_port.getPort();
+}
+
+bool SerialTransport::wait_readable() {
+    return serial_port.waitReadable();
+}
+
+size_t SerialTransport::available() {
+    return serial_port.available();
+}
+
+size_t SerialTransport::read(uint8_t *buffer, size_t size) {
+    return serial_port.read(buffer, size);
+}
+
+size_t SerialTransport::write(const uint8_t *data, size_t size) {
+    return serial_port.write(data, size);
+}
+
+void SerialTransport::wait_for_device(std::chrono::milliseconds timeout) {
+    hotplug_monitor.wait(timeout);
+}
+
+std::pair<std::unique_ptr<LoopbackTransport>, std::unique_ptr<LoopbackTransport>> LoopbackTransport::create_pair() {
+    auto a_to_b = std::make_shared<Pipe>();
+    auto b_to_a = std::make_shared<Pipe>();
+    return std::make_pair(std::unique_ptr<LoopbackTransport>(new LoopbackTransport("loopback:a", b_to_a, a_to_b)),
+                          std::unique_ptr<LoopbackTransport>(new LoopbackTransport("loopback:b", a_to_b, b_to_a)));
+}
+
+LoopbackTransport::LoopbackTransport(std::string name, std::shared_ptr<Pipe> _rx_pipe, std::shared_ptr<Pipe> _tx_pipe)
+        : loopback_name(std::move(name)), rx_pipe(std::move(_rx_pipe)), tx_pipe(std::move(_tx_pipe)), opened(false) {
+
+}
+
+bool LoopbackTransport::open() {
+    opened = true;
+    return true;
+}
+
+void LoopbackTransport::close() {
+    opened = false;
+}
+
+bool LoopbackTransport::is_open() {
+    return opened;
+}
+
+std::string LoopbackTransport::name() {
+    return loopback_name;
+}
+
+bool LoopbackTransport::wait_readable() {
+    // Same as the serial read timeout, so the SDK threads notice shutdown as quickly.
+    return wait_readable(std::chrono::milliseconds(200));
+}
+
+bool LoopbackTransport::wait_readable(std::chrono::microseconds timeout) {
+    std::unique_lock<std::mutex> lock(rx_pipe->mutex);
+    return rx_pipe->condition_variable.wait_for(lock, timeout, [this]() { return !rx_pipe->bytes.empty(); });
+}
+
+size_t LoopbackTransport::available() {
+    std::lock_guard<std::mutex> lock(rx_pipe->mutex);
+    return rx_pipe->bytes.size();
+}
+
+size_t LoopbackTransport::read(uint8_t *buffer, size_t size) {
+    std::lock_guard<std::mutex> lock(rx_pipe->mutex);
+    size = std::min(size, rx_pipe->bytes.size());
+    std::copy(rx_pipe->bytes.begin(), rx_pipe->bytes.begin() + size, buffer);
+    rx_pipe->bytes.erase(rx_pipe->bytes.begin(), rx_pipe->bytes.begin() + size);
+    return size;
+}
+
+size_t LoopbackTransport::write(const uint8_t *data, size_t size) {
+    std::lock_guard<std::mutex> lock(tx_pipe->mutex);
+    tx_pipe->bytes.insert(tx_pipe->bytes.end(), data, data + size);
+    tx_pipe->condition_variable.notify_one();
+    return size;
+}
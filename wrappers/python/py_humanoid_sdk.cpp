@@ -1,5 +1,6 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
+#include <pybind11/numpy.h>
 #include "humanoid_sdk.h"
 
 namespace py = pybind11;
@@ -7,9 +8,165 @@ using namespace pybind11::literals;
 
 using humanoid_sdk::LinearActuatorFeedback;
 
+using SDKPtr = std::shared_ptr<humanoid_sdk::HumanoidSDK>;
+
+// Contiguous arrays, anything else (lists, other dtypes) is converted on the way in.
+using IdArray = py::array_t<uint8_t, py::array::c_style | py::array::forcecast>;
+using TargetArray = py::array_t<uint16_t, py::array::c_style | py::array::forcecast>;
+using FeedbackArray = py::array_t<LinearActuatorFeedback>;
+
+// asyncio future of a request in flight. The Python objects are released under the GIL as soon as the request
+// completes or is cancelled, so the SDK can drop the callback holding this from any thread.
+struct FutureState {
+    py::object loop;
+    py::object future;
+
+    void clear() {
+        loop = py::object();
+        future = py::object();
+    }
+
+    ~FutureState() {
+        if (loop || future) {
+            py::gil_scoped_acquire acquire;
+            clear();
+        }
+    }
+};
+
+// The shared instance of get_instance(), never deleted.
+static SDKPtr default_sdk() {
+    return SDKPtr(&humanoid_sdk::HumanoidSDK::get_instance(), [](humanoid_sdk::HumanoidSDK *) {});
+}
+
+static py::object to_python(const LinearActuatorFeedback &feedback) {
+    return py::cast(feedback);
+}
+
+static py::object to_python(const std::string &bytes) {
+    return py::bytes(bytes);
+}
+
+static py::object to_python(float value) {
+    return py::float_(value);
+}
+
+// Runs on the event loop thread.
+static void resolve_future(py::object future, bool success, py::object result) {
+    if (future.attr("done")().cast<bool>()) {
+        return;
+    }
+    if (success) {
+        future.attr("set_result")(result);
+    } else {
+        future.attr("set_exception")(py::handle(PyExc_TimeoutError)("Timeout"));
+    }
+}
+
+// Start an asynchronous SDK request with call(callback) and return an asyncio future of the running loop,
+// resolved from the SDK RX thread with the Result passed to the callback, or failed with TimeoutError.
+// Cancelling the future drops the request.
+template<typename Result, typename Call>
+py::object rpc_future(const SDKPtr &sdk_ptr, Call call) {
+    // Raises RuntimeError when called outside a coroutine.
+    py::object loop = py::module::import("asyncio").attr("get_running_loop")();
+    auto state = std::make_shared<FutureState>();
+    state->loop = loop;
+    state->future = loop.attr("create_future")();
+    py::object future = state->future;
+
+    humanoid_sdk::RpcHandle handle;
+    {
+        py::gil_scoped_release release;
+        handle = call([state](bool success, const Result &result) {
+            py::gil_scoped_acquire acquire;
+            if (!state->loop) {
+                return;
+            }
+            try {
+                state->loop.attr("call_soon_threadsafe")(py::cpp_function(&resolve_future), state->future,
+                                                         success, to_python(result));
+            } catch (py::error_already_set &) {
+                // The event loop is closed, nobody waits for the result any more.
+            }
+            state->clear();
+        });
+    }
+
+    SDKPtr sdk_ref = sdk_ptr;
+    future.attr("add_done_callback")(py::cpp_function([sdk_ref, state, handle](py::object f) {
+        if (!f.attr("cancelled")().cast<bool>()) {
+            return;
+        }
+        bool cancelled;
+        {
+            py::gil_scoped_release release;
+            cancelled = sdk_ref->cancel_rpc(handle);
+        }
+        if (cancelled) {
+            state->clear();
+        }
+    }));
+    return future;
+}
+
+// Feedback of one actuator as it arrives, see HumanoidSDK::subscribe_linear_actuator().
+class LinearActuatorStream {
+public:
+    LinearActuatorStream(SDKPtr _sdk_ptr, std::shared_ptr<humanoid_sdk::LinearActuatorSubscription> _subscription)
+            : sdk_ptr(std::move(_sdk_ptr)), subscription(std::move(_subscription)) { }
+
+    LinearActuatorStream(LinearActuatorStream &&) = default;
+
+    LinearActuatorStream(LinearActuatorStream const&) = delete;
+    void operator=(LinearActuatorStream const&) = delete;
+
+    ~LinearActuatorStream() {
+        close();
+    }
+
+    // Up to max_count samples as (timestamps, feedbacks): steady clock nanoseconds and a structured array.
+    // Waits up to timeout_ms for the first sample.
+    py::tuple pop(size_t max_count, int timeout_ms) {
+        std::vector<humanoid_sdk::LinearActuatorSample> samples(max_count);
+        size_t count;
+        {
+            py::gil_scoped_release release;
+            count = subscription->wait_pop(samples.data(), max_count, std::chrono::milliseconds(timeout_ms));
+        }
+        py::array_t<int64_t> timestamps((py::ssize_t) count);
+        FeedbackArray feedbacks((py::ssize_t) count);
+        int64_t *p_timestamp = timestamps.mutable_data();
+        LinearActuatorFeedback *p_feedback = feedbacks.mutable_data();
+        for (size_t i = 0; i < count; ++i) {
+            p_timestamp[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    samples[i].timestamp.time_since_epoch()).count();
+            p_feedback[i] = samples[i].feedback;
+        }
+        return py::make_tuple(timestamps, feedbacks);
+    }
+
+    uint64_t dropped() {
+        return subscription->dropped();
+    }
+
+    void close() {
+        if (subscription && !subscription->closed()) {
+            py::gil_scoped_release release;
+            sdk_ptr->unsubscribe(subscription);
+        }
+    }
+
+private:
+    SDKPtr sdk_ptr;
+    std::shared_ptr<humanoid_sdk::LinearActuatorSubscription> subscription;
+};
+
 class LinearActuator {
 public:
-    LinearActuator() : sdk(humanoid_sdk::HumanoidSDK::get_instance()) { }
+    LinearActuator() : LinearActuator(default_sdk()) { }
+
+    explicit LinearActuator(SDKPtr _sdk_ptr) : sdk_ptr(std::move(_sdk_ptr)), sdk(*sdk_ptr) { }
 
     LinearActuatorFeedback set_target(uint8_t id, uint16_t target) {
         LinearActuatorFeedback feedback;
@@ -83,38 +240,189 @@ public:
         sdk.linear_actuator_follow_silent(id, target);
     }
 
-    void broadcast_targets(const std::vector<uint8_t>& ids, const std::vector<uint16_t>& targets) {
-        sdk.linear_actuator_broadcast_targets(ids, targets);
+    void broadcast_targets(const IdArray &ids, const TargetArray &targets) {
+        size_t count = check_targets(ids, targets);
+        const uint8_t *p_ids = ids.data();
+        const uint16_t *p_targets = targets.data();
+        py::gil_scoped_release release;
+        sdk.linear_actuator_broadcast_targets(p_ids, p_targets, count);
+    }
+
+    void broadcast_follows(const IdArray &ids, const TargetArray &targets) {
+        size_t count = check_targets(ids, targets);
+        const uint8_t *p_ids = ids.data();
+        const uint16_t *p_targets = targets.data();
+        py::gil_scoped_release release;
+        sdk.linear_actuator_broadcast_follows(p_ids, p_targets, count);
+    }
+
+    // Awaitable variants, they return an asyncio future of the running loop resolved from the SDK RX thread with
+    // the feedback, or failed with TimeoutError. Cancelling the future drops the request.
+
+    py::object set_target_async(uint8_t id, uint16_t target, int timeout_ms) {
+        return rpc_future<LinearActuatorFeedback>(sdk_ptr, [&](humanoid_sdk::LinearActuatorCallback callback) {
+            return sdk.linear_actuator_set_target_async(id, target, std::move(callback),
+                                                        std::chrono::milliseconds(timeout_ms));
+        });
+    }
+
+    py::object follow_async(uint8_t id, uint16_t target, int timeout_ms) {
+        return rpc_future<LinearActuatorFeedback>(sdk_ptr, [&](humanoid_sdk::LinearActuatorCallback callback) {
+            return sdk.linear_actuator_follow_async(id, target, std::move(callback),
+                                                    std::chrono::milliseconds(timeout_ms));
+        });
+    }
+
+    py::object enable_async(uint8_t id, int timeout_ms) {
+        return rpc_future<LinearActuatorFeedback>(sdk_ptr, [&](humanoid_sdk::LinearActuatorCallback callback) {
+            return sdk.linear_actuator_enable_async(id, std::move(callback), std::chrono::milliseconds(timeout_ms));
+        });
+    }
+
+    py::object stop_async(uint8_t id, int timeout_ms) {
+        return rpc_future<LinearActuatorFeedback>(sdk_ptr, [&](humanoid_sdk::LinearActuatorCallback callback) {
+            return sdk.linear_actuator_stop_async(id, std::move(callback), std::chrono::milliseconds(timeout_ms));
+        });
+    }
+
+    py::object pause_async(uint8_t id, int timeout_ms) {
+        return rpc_future<LinearActuatorFeedback>(sdk_ptr, [&](humanoid_sdk::LinearActuatorCallback callback) {
+            return sdk.linear_actuator_pause_async(id, std::move(callback), std::chrono::milliseconds(timeout_ms));
+        });
+    }
+
+    py::object save_parameters_async(uint8_t id, int timeout_ms) {
+        return rpc_future<LinearActuatorFeedback>(sdk_ptr, [&](humanoid_sdk::LinearActuatorCallback callback) {
+            return sdk.linear_actuator_save_parameters_async(id, std::move(callback),
+                                                             std::chrono::milliseconds(timeout_ms));
+        });
+    }
+
+    py::object query_state_async(uint8_t id, int timeout_ms) {
+        return rpc_future<LinearActuatorFeedback>(sdk_ptr, [&](humanoid_sdk::LinearActuatorCallback callback) {
+            return sdk.linear_actuator_query_state_async(id, std::move(callback),
+                                                         std::chrono::milliseconds(timeout_ms));
+        });
+    }
+
+    py::object clear_error_async(uint8_t id, int timeout_ms) {
+        return rpc_future<LinearActuatorFeedback>(sdk_ptr, [&](humanoid_sdk::LinearActuatorCallback callback) {
+            return sdk.linear_actuator_clear_error_async(id, std::move(callback),
+                                                         std::chrono::milliseconds(timeout_ms));
+        });
+    }
+
+    LinearActuatorStream subscribe(uint8_t id, size_t capacity, humanoid_sdk::OverflowPolicy policy) {
+        return LinearActuatorStream(sdk_ptr, sdk.subscribe_linear_actuator(id, capacity, policy));
+    }
+
+    // Query all ids at once, returns (feedbacks, valid): a structured array with one row per id and a bool array,
+    // rows whose valid entry is False timed out and are zero.
+    py::tuple query_states(const IdArray &ids, int timeout_ms) {
+        std::vector<uint8_t> id_list(ids.data(), ids.data() + ids.size());
+        std::vector<LinearActuatorFeedback> feedbacks;
+        std::vector<bool> success;
+        {
+            py::gil_scoped_release release;
+            success = sdk.linear_actuator_query_states(id_list, feedbacks, std::chrono::milliseconds(timeout_ms));
+        }
+        return feedback_arrays(feedbacks, success);
     }
 
-    void broadcast_follows(const std::vector<uint8_t>& ids, const std::vector<uint16_t>& targets) {
-        sdk.linear_actuator_broadcast_follows(ids, targets);
+    // Latest feedback of each id from the cache without any serial traffic, same layout as query_states().
+    // Entries older than max_age_ms are reported invalid.
+    py::tuple cached_states(const IdArray &ids, int max_age_ms) {
+        size_t count = (size_t) ids.size();
+        const uint8_t *p_ids = ids.data();
+        std::vector<LinearActuatorFeedback> feedbacks(count);
+        std::vector<bool> success(count);
+        {
+            py::gil_scoped_release release;
+            for (size_t i = 0; i < count; ++i) {
+                success[i] = sdk.linear_actuator_cached_state(p_ids[i], feedbacks[i],
+                                                              std::chrono::milliseconds(max_age_ms));
+            }
+        }
+        return feedback_arrays(feedbacks, success);
     }
 
 private:
+    SDKPtr sdk_ptr;
     humanoid_sdk::HumanoidSDK& sdk;
+
+    static size_t check_targets(const IdArray &ids, const TargetArray &targets) {
+        if (ids.ndim() != 1 || targets.ndim() != 1 || ids.size() != targets.size()) {
+            throw std::invalid_argument("ids and targets must be 1-D arrays of the same length");
+        }
+        return (size_t) ids.size();
+    }
+
+    static py::tuple feedback_arrays(const std::vector<LinearActuatorFeedback> &feedbacks,
+                                     const std::vector<bool> &success) {
+        FeedbackArray feedback_array((py::ssize_t) success.size());
+        py::array_t<bool> valid_array((py::ssize_t) success.size());
+        LinearActuatorFeedback *p_feedback = feedback_array.mutable_data();
+        bool *p_valid = valid_array.mutable_data();
+        for (size_t i = 0; i < success.size(); ++i) {
+            p_valid[i] = success[i];
+            p_feedback[i] = success[i] ? feedbacks[i] : LinearActuatorFeedback();
+        }
+        return py::make_tuple(feedback_array, valid_array);
+    }
 };
 
 class Maestro {
 public:
-    Maestro() : sdk(humanoid_sdk::HumanoidSDK::get_instance()) { }
+    Maestro() : Maestro(default_sdk()) { }
+
+    explicit Maestro(SDKPtr _sdk_ptr) : sdk_ptr(std::move(_sdk_ptr)), sdk(*sdk_ptr) { }
 
     void set_channel(uint8_t channel, uint16_t target) {
         sdk.set_maestro_channel(channel, target);
     }
 
-    void set_all_channel(const std::vector<uint16_t>& targets) {
-        sdk.set_maestro_all_channel(targets);
+    void set_all_channel(const TargetArray &targets) {
+        std::vector<uint16_t> target_list(targets.data(), targets.data() + targets.size());
+        py::gil_scoped_release release;
+        sdk.set_maestro_all_channel(target_list);
     };
 
 private:
+    SDKPtr sdk_ptr;
     humanoid_sdk::HumanoidSDK& sdk;
 };
 
 class HumanoidSDK {
 public:
-    HumanoidSDK() : sdk(humanoid_sdk::HumanoidSDK::get_instance()) { }
+    // Without any selector every HumanoidSDK object shares the first board found.
+    HumanoidSDK(const std::string &port, const std::string &serial_number, const std::string &uid)
+            : sdk_ptr(create_sdk(port, serial_number, uid)), sdk(*sdk_ptr),
+              linear_actuator(sdk_ptr), maestro(sdk_ptr) { }
 
+private:
+    SDKPtr sdk_ptr;
+    humanoid_sdk::HumanoidSDK& sdk;
+
+    static SDKPtr create_sdk(const std::string &port, const std::string &serial_number, const std::string &uid) {
+        if (port.empty() && serial_number.empty() && uid.empty()) {
+            return default_sdk();
+        }
+        humanoid_sdk::HumanoidSDKOptions options;
+        options.port = port;
+        options.serial_number = serial_number;
+        options.uid = uid;
+        // The destructor joins the RX thread, which may be waiting for the GIL to complete a future.
+        return SDKPtr(new humanoid_sdk::HumanoidSDK(options), [](humanoid_sdk::HumanoidSDK *p) {
+            if (PyGILState_Check()) {
+                py::gil_scoped_release release;
+                delete p;
+            } else {
+                delete p;
+            }
+        });
+    }
+
+public:
     LinearActuator linear_actuator;
 
     Maestro maestro;
@@ -125,7 +433,12 @@ public:
 
     py::bytes read_uid() {
         std::string uid;
-        if(!sdk.read_uid(uid)) {
+        bool success;
+        {
+            py::gil_scoped_release release;
+            success = sdk.read_uid(uid);
+        }
+        if(!success) {
             throw std::runtime_error("Timeout");
         }
         return uid;
@@ -139,6 +452,20 @@ public:
         return temperature;
     }
 
+    // Awaitable variants, see LinearActuator.
+
+    py::object read_uid_async(int timeout_ms) {
+        return rpc_future<std::string>(sdk_ptr, [&](humanoid_sdk::UidCallback callback) {
+            return sdk.read_uid_async(std::move(callback), std::chrono::milliseconds(timeout_ms));
+        });
+    }
+
+    py::object read_temperature_async(int timeout_ms) {
+        return rpc_future<float>(sdk_ptr, [&](humanoid_sdk::TemperatureCallback callback) {
+            return sdk.read_temperature_async(std::move(callback), std::chrono::milliseconds(timeout_ms));
+        });
+    }
+
     void write_console(const std::string &s) {
         sdk.write_console(s);
     }
@@ -149,41 +476,123 @@ public:
         return s;
     }
 
-private:
-    humanoid_sdk::HumanoidSDK& sdk;
+    // Next complete line of console output or None.
+    py::object console_read_line() {
+        std::string line;
+        bool success;
+        {
+            py::gil_scoped_release release;
+            success = sdk.console_read_line(line);
+        }
+        if (!success) {
+            return py::none();
+        }
+        return py::str(line);
+    }
+
+    py::dict get_metrics() {
+        humanoid_sdk::Metrics metrics;
+        {
+            py::gil_scoped_release release;
+            metrics = sdk.get_metrics();
+        }
+        auto latency_dict = [](const humanoid_sdk::LatencySnapshot &snapshot) {
+            return py::dict("count"_a = snapshot.count,
+                            "mean_us"_a = snapshot.mean.count(),
+                            "p50_us"_a = snapshot.percentile(50).count(),
+                            "p90_us"_a = snapshot.percentile(90).count(),
+                            "p99_us"_a = snapshot.percentile(99).count(),
+                            "max_us"_a = snapshot.max.count());
+        };
+        py::dict rpc_latency;
+        for (auto &latency : metrics.rpc_latency) {
+            rpc_latency[py::int_(latency.first)] = latency_dict(latency.second);
+        }
+        return py::dict("rx_bytes"_a = metrics.rx_bytes,
+                        "rx_read_calls"_a = metrics.rx_read_calls,
+                        "rx_frames"_a = metrics.rx_frames,
+                        "tx_bytes"_a = metrics.tx_bytes,
+                        "tx_write_calls"_a = metrics.tx_write_calls,
+                        "tx_frames"_a = metrics.tx_frames,
+                        "tx_dropped_frames"_a = metrics.tx_dropped_frames,
+                        "crc8_errors"_a = metrics.crc8_errors,
+                        "crc16_errors"_a = metrics.crc16_errors,
+                        "resyncs"_a = metrics.resyncs,
+                        "rpc_timeouts"_a = metrics.rpc_timeouts,
+                        "serial_errors"_a = metrics.serial_errors,
+                        "reconnects"_a = metrics.reconnects,
+                        "tx_queue_depth"_a = metrics.tx_queue_depth,
+                        "tx_queue_depth_max"_a = metrics.tx_queue_depth_max,
+                        "console_dropped_bytes"_a = metrics.console_dropped_bytes,
+                        "reconnect_time"_a = latency_dict(metrics.reconnect_time),
+                        "rpc_latency"_a = rpc_latency);
+    }
 };
 
 PYBIND11_MODULE(py_humanoid_sdk, m) {
     m.doc() = "humanoid_sdk python wrapper.";
 
+    // Every call that waits on the serial link runs without the GIL so other Python threads keep running.
+    using release_gil = py::call_guard<py::gil_scoped_release>;
+
+    PYBIND11_NUMPY_DTYPE(LinearActuatorFeedback, id, target_position, current_position, temperature, force_sensor,
+                         error_code, internal_data1, internal_data2);
+
+    py::enum_<humanoid_sdk::OverflowPolicy>(m, "OverflowPolicy")
+        .value("DROP_OLDEST", humanoid_sdk::OverflowPolicy::DROP_OLDEST)
+        .value("DROP_NEWEST", humanoid_sdk::OverflowPolicy::DROP_NEWEST)
+        .value("BLOCK", humanoid_sdk::OverflowPolicy::BLOCK);
+
+    py::class_<LinearActuatorStream>(m, "LinearActuatorStream")
+        .def("pop", &LinearActuatorStream::pop, "max_count"_a = 256, "timeout_ms"_a = 0)
+        .def("dropped", &LinearActuatorStream::dropped)
+        .def("close", &LinearActuatorStream::close);
+
     py::class_<HumanoidSDK>(m, "HumanoidSDK")
-        .def(py::init<>())
+        .def(py::init<const std::string &, const std::string &, const std::string &>(),
+             "port"_a = "", "serial_number"_a = "", "uid"_a = "")
         .def_readonly("linear_actuator", &HumanoidSDK::linear_actuator)
         .def_readonly("maestro", &HumanoidSDK::maestro)
         .def("is_connected", &HumanoidSDK::is_connected)
         .def("read_uid", &HumanoidSDK::read_uid)
-        .def("read_temperature", &HumanoidSDK::read_temperature)
-        .def("write_console", &HumanoidSDK::write_console, "s"_a)
-        .def("console_output", &HumanoidSDK::console_output);
+        .def("read_temperature", &HumanoidSDK::read_temperature, release_gil())
+        .def("read_uid_async", &HumanoidSDK::read_uid_async, "timeout_ms"_a = 100)
+        .def("read_temperature_async", &HumanoidSDK::read_temperature_async, "timeout_ms"_a = 100)
+        .def("write_console", &HumanoidSDK::write_console, "s"_a, release_gil())
+        .def("console_output", &HumanoidSDK::console_output, release_gil())
+        .def("console_read_line", &HumanoidSDK::console_read_line)
+        .def("get_metrics", &HumanoidSDK::get_metrics);
 
     py::class_<LinearActuator>(m, "LinearActuator")
         .def(py::init<>())
-        .def("set_target", &LinearActuator::set_target, "id"_a, "target"_a)
-        .def("follow", &LinearActuator::follow, "id"_a, "target"_a)
-        .def("enable", &LinearActuator::enable, "id"_a)
-        .def("stop", &LinearActuator::stop, "id"_a)
-        .def("pause", &LinearActuator::pause, "id"_a)
-        .def("save_parameters", &LinearActuator::save_parameters, "id"_a)
-        .def("query_state", &LinearActuator::query_state, "id"_a)
-        .def("clear_error", &LinearActuator::clear_error, "id"_a)
-        .def("set_target_silent", &LinearActuator::set_target_silent, "id"_a, "target"_a)
-        .def("follow_silent", &LinearActuator::follow_silent, "id"_a, "target"_a)
+        .def("set_target", &LinearActuator::set_target, "id"_a, "target"_a, release_gil())
+        .def("follow", &LinearActuator::follow, "id"_a, "target"_a, release_gil())
+        .def("enable", &LinearActuator::enable, "id"_a, release_gil())
+        .def("stop", &LinearActuator::stop, "id"_a, release_gil())
+        .def("pause", &LinearActuator::pause, "id"_a, release_gil())
+        .def("save_parameters", &LinearActuator::save_parameters, "id"_a, release_gil())
+        .def("query_state", &LinearActuator::query_state, "id"_a, release_gil())
+        .def("clear_error", &LinearActuator::clear_error, "id"_a, release_gil())
+        .def("set_target_silent", &LinearActuator::set_target_silent, "id"_a, "target"_a, release_gil())
+        .def("follow_silent", &LinearActuator::follow_silent, "id"_a, "target"_a, release_gil())
         .def("broadcast_targets", &LinearActuator::broadcast_targets, "ids"_a, "targets"_a)
-        .def("broadcast_follows", &LinearActuator::broadcast_follows, "ids"_a, "targets"_a);
+        .def("broadcast_follows", &LinearActuator::broadcast_follows, "ids"_a, "targets"_a)
+        .def("set_target_async", &LinearActuator::set_target_async, "id"_a, "target"_a, "timeout_ms"_a = 100)
+        .def("follow_async", &LinearActuator::follow_async, "id"_a, "target"_a, "timeout_ms"_a = 100)
+        .def("enable_async", &LinearActuator::enable_async, "id"_a, "timeout_ms"_a = 100)
+        .def("stop_async", &LinearActuator::stop_async, "id"_a, "timeout_ms"_a = 100)
+        .def("pause_async", &LinearActuator::pause_async, "id"_a, "timeout_ms"_a = 100)
+        .def("save_parameters_async", &LinearActuator::save_parameters_async, "id"_a, "timeout_ms"_a = 100)
+        .def("query_state_async", &LinearActuator::query_state_async, "id"_a, "timeout_ms"_a = 100)
+        .def("clear_error_async", &LinearActuator::clear_error_async, "id"_a, "timeout_ms"_a = 100)
+        .def("subscribe", &LinearActuator::subscribe, "id"_a, "capacity"_a = 256,
+             "policy"_a = humanoid_sdk::OverflowPolicy::DROP_OLDEST)
+        .def("query_states", &LinearActuator::query_states, "ids"_a, "timeout_ms"_a = 100)
+        .def("cached_states", &LinearActuator::cached_states, "ids"_a, "max_age_ms"_a = 100);
 
     py::class_<Maestro>(m, "Maestro")
         .def(py::init<>())
-        .def("set_channel", &Maestro::set_channel, "channel"_a, "target"_a)
+        .def("set_channel", &Maestro::set_channel, "channel"_a, "target"_a, release_gil())
         .def("set_all_channel", &Maestro::set_all_channel, "targets"_a);
 
     py::class_<LinearActuatorFeedback>(m, "LinearActuatorFeedback")